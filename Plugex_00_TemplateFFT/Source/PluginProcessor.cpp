@@ -54,10 +54,9 @@ Plugex_00_templateFftAudioProcessor::Plugex_00_templateFftAudioProcessor()
     lastOverlaps = 1 << (int)*overlapsParameter;
     lastWintype = (int)*overlapsParameter;
 
-    for (auto channel = 0; channel < 2; channel++) {
-        fftEngine[channel].setup(lastOrder, lastOverlaps, lastWintype);
-        fftEngine[channel].addListener(this);
-    }
+    fftEngine.setup(lastOrder, lastOverlaps, lastWintype);
+    fftEngine.addListener(this);
+    startTimer(50);
 }
 
 Plugex_00_templateFftAudioProcessor::~Plugex_00_templateFftAudioProcessor()
@@ -131,6 +130,10 @@ void Plugex_00_templateFftAudioProcessor::prepareToPlay (double sampleRate, int
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    int maxOrder = (int) parameters.getParameterRange("order").end;
+    fftEngine.prepare(maxOrder, getTotalNumInputChannels() == 2);
+    pendingLatency = fftEngine.getLatencyInSamples();
+    setLatencySamples(pendingLatency);
 }
 
 void Plugex_00_templateFftAudioProcessor::releaseResources()
@@ -167,6 +170,18 @@ void Plugex_00_templateFftAudioProcessor::fftEngineFrameReady(FFTEngine *engine,
     // Function callback to process FFT frames.
 }
 
+void Plugex_00_templateFftAudioProcessor::fftEngineSetupChanged(FFTEngine *engine) {
+    // Function callback called when a new order/overlaps/wintype becomes active.
+    // It runs on the audio thread, so the latency is reported later by the timer.
+    pendingLatency = fftEngine.getLatencyInSamples();
+}
+
+void Plugex_00_templateFftAudioProcessor::timerCallback() {
+    int latency = pendingLatency.load();
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
+
 void Plugex_00_templateFftAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
     ScopedNoDenormals noDenormals;
@@ -180,17 +195,21 @@ void Plugex_00_templateFftAudioProcessor::processBlock (AudioBuffer<float>& buff
     int overlaps = 1 << (int) *overlapsParameter;
     int wintype = (int) *wintypeParameter;
 
-    for (auto channel = 0; channel < totalNumInputChannels; channel++) {
-        if (order != lastOrder || overlaps != lastOverlaps) {
-            fftEngine[channel].setup(order, overlaps, wintype);
-        }
-        if (wintype != lastWintype) {
-            fftEngine[channel].setWintype(wintype);
-        }
-        auto *channelData = buffer.getWritePointer(channel);
-        for (int i = 0; i < buffer.getNumSamples(); i++) {
-            channelData[i] = fftEngine[channel].process(channelData[i]);
-        }
+    if (order != lastOrder || overlaps != lastOverlaps) {
+        fftEngine.setup(order, overlaps, wintype);
+    }
+    if (wintype != lastWintype) {
+        fftEngine.setWintype(wintype);
+    }
+
+    // A stereo-linked engine transforms both channels with a single complex FFT.
+    if (fftEngine.getNumChannels() == 2) {
+        auto *leftData = buffer.getWritePointer(0);
+        auto *rightData = buffer.getWritePointer(1);
+        fftEngine.processBlock(leftData, rightData, leftData, rightData, buffer.getNumSamples());
+    } else {
+        auto *channelData = buffer.getWritePointer(0);
+        fftEngine.processBlock(channelData, channelData, buffer.getNumSamples());
     }
     lastOrder = order;
     lastOverlaps = overlaps;
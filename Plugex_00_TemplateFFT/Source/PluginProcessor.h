@@ -15,7 +15,8 @@
 #include "FFTEngine.h"
 
 class Plugex_00_templateFftAudioProcessor  : public AudioProcessor,
-                                             public FFTEngine::Listener
+                                             public FFTEngine::Listener,
+                                             public Timer
 {
 public:
     //==============================================================================
@@ -57,17 +58,23 @@ public:
 
     // FFTEngine::Listener
     void fftEngineFrameReady(FFTEngine *engine, float *fftData, int fftSize) override;
+    void fftEngineSetupChanged(FFTEngine *engine) override;
+
+    void timerCallback() override;
 
 private:
     //==============================================================================
     AudioProcessorValueTreeState parameters;
 
-    FFTEngine fftEngine[2];
+    FFTEngine fftEngine;
 
     int lastOrder;
     int lastOverlaps;
     int lastWintype;
 
+    // Latency of the active FFT setup, reported to the host from the message thread.
+    std::atomic<int> pendingLatency { 0 };
+
     std::atomic<float> *orderParameter = nullptr;
     std::atomic<float> *overlapsParameter = nullptr;
     std::atomic<float> *wintypeParameter = nullptr;
@@ -16,6 +16,10 @@
 #define M_PI (3.14159265358979323846264338327950288)
 #endif
 
+// The filters process chunks of this many samples, their frequencies and Qs
+// follow the smoothed parameters once per chunk.
+static const int filterBlockSize = 64;
+
 static String freqSliderValueToText(float value) {
     return String(value, 2) + String(" Hz");
 }
@@ -186,10 +190,8 @@ void Plugex_17_fullDistortionAudioProcessor::prepareToPlay (double sampleRate, i
     balanceSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     balanceSmoothed.setCurrentAndTargetValue(*balanceParameter);
 
-    for (int channel = 0; channel < 2; channel++) {
-        highpassFilter[channel].setup(sampleRate);
-        lowpassFilter[channel].setup(sampleRate);
-    }
+    highpassFilter.setup(sampleRate, 2);
+    lowpassFilter.setup(sampleRate, 2);
 }
 
 void Plugex_17_fullDistortionAudioProcessor::releaseResources()
@@ -238,25 +240,47 @@ void Plugex_17_fullDistortionAudioProcessor::processBlock (AudioBuffer<float>& b
     lowpassQSmoothed.setTargetValue(*lowpassQParameter);
     balanceSmoothed.setTargetValue(*balanceParameter);
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
+    int numChannels = jmin(totalNumInputChannels, 2);
+    float *channels[2];
+    float channelInputs[2][filterBlockSize];
+    float balances[filterBlockSize];
+
+    for (int start = 0; start < buffer.getNumSamples(); start += filterBlockSize)
     {
-        float currentHighpassFreq = highpassFreqSmoothed.getNextValue();
-        float currentHighpassQ = highpassQSmoothed.getNextValue();
-        float currentDrive = driveSmoothed.getNextValue() * 0.998;
-        float currentLowpassFreq = lowpassFreqSmoothed.getNextValue();
-        float currentLowpassQ = lowpassQSmoothed.getNextValue();
-        float currentBalance = balanceSmoothed.getNextValue() * 0.01;
-        float shapeFactor = (2.0f * currentDrive) / (1.0f - currentDrive);
-        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+        int chunkSize = jmin(filterBlockSize, buffer.getNumSamples() - start);
+
+        highpassFilter.setParameters(highpassFreqSmoothed.skip(chunkSize), highpassQSmoothed.skip(chunkSize), 1);
+        lowpassFilter.setParameters(lowpassFreqSmoothed.skip(chunkSize), lowpassQSmoothed.skip(chunkSize), 0);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            channels[channel] = buffer.getWritePointer (channel, start);
+            FloatVectorOperations::copy(channelInputs[channel], channels[channel], chunkSize);
+        }
+
+        // Both channels are filtered together, one per SIMD lane.
+        highpassFilter.processBlock(channels, numChannels, chunkSize);
+
+        for (int i = 0; i < chunkSize; i++)
+        {
+            float currentDrive = driveSmoothed.getNextValue() * 0.998;
+            float shapeFactor = (2.0f * currentDrive) / (1.0f - currentDrive);
+            balances[i] = balanceSmoothed.getNextValue() * 0.01;
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                float *channelData = channels[channel];
+                channelData[i] = (1.0f + shapeFactor) * channelData[i] / (1.0f + shapeFactor * fabsf(channelData[i])) * 0.7;
+            }
+        }
+
+        lowpassFilter.processBlock(channels, numChannels, chunkSize);
+
+        for (int channel = 0; channel < numChannels; ++channel)
         {
-            highpassFilter[channel].setParameters(currentHighpassFreq, currentHighpassQ, 1);
-            lowpassFilter[channel].setParameters(currentLowpassFreq, currentLowpassQ, 0);
-            auto* channelData = buffer.getWritePointer (channel);
-            float channelInput = channelData[i];
-            channelData[i] = highpassFilter[channel].process(channelData[i]);
-            channelData[i] = (1.0f + shapeFactor) * channelData[i] / (1.0f + shapeFactor * fabsf(channelData[i])) * 0.7;
-            channelData[i] = lowpassFilter[channel].process(channelData[i]);
-            channelData[i] = channelInput + (channelData[i] - channelInput) * currentBalance;
+            float *channelData = channels[channel];
+            for (int i = 0; i < chunkSize; i++) {
+                channelData[i] = channelInputs[channel][i] + (channelData[i] - channelInputs[channel][i]) * balances[i];
+            }
         }
     }
 }
@@ -12,7 +12,7 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
-#include "Biquad.h"
+#include "MultiChannelBiquad.h"
 
 //==============================================================================
 /**
@@ -81,8 +81,8 @@ private:
     std::atomic<float> *balanceParameter = nullptr;
     SmoothedValue<float> balanceSmoothed;
 
-    Biquad highpassFilter[2];
-    Biquad lowpassFilter[2];
+    MultiChannelBiquad highpassFilter;
+    MultiChannelBiquad lowpassFilter;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Plugex_17_fullDistortionAudioProcessor)
 };
@@ -159,9 +159,11 @@ void Plugex_19_smoothDelayAudioProcessor::prepareToPlay (double sampleRate, int
     balanceSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     balanceSmoothed.setCurrentAndTargetValue(*balanceParameter);
 
+    delayArena.clear();
     for (int channel = 0; channel < 2; channel++) {
-        delayLine[channel].setup(1.f, currentSampleRate);
+        delayLine[channel].setup(delayArena, 1.f, currentSampleRate);
     }
+    delayArena.allocate();
 }
 
 void Plugex_19_smoothDelayAudioProcessor::releaseResources()
@@ -248,12 +250,19 @@ void Plugex_19_smoothDelayAudioProcessor::processBlock (AudioBuffer<float>& buff
 
         computeDelayTime(currentTime);
 
+        // Both delays are taps of the same line, each one fed back with its gain.
+        float tapDelays[2], tapFeedbacks[2];
+        tapDelays[0] = delay1Time * currentSampleRate;
+        tapDelays[1] = delay2Time * currentSampleRate;
+        tapFeedbacks[0] = delay1Gain * currentFeedback;
+        tapFeedbacks[1] = delay2Gain * currentFeedback;
+
         for (int channel = 0; channel < totalNumInputChannels; ++channel)
         {
-            float sampleRead = delayLine[channel].read(delay1Time) * delay1Gain;
-            sampleRead += delayLine[channel].read(delay2Time) * delay2Gain;
+            float taps[2];
             auto* channelData = buffer.getWritePointer (channel);
-            delayLine[channel].write(channelData[i] + sampleRead * currentFeedback);
+            delayLine[channel].processTaps(channelData[i], tapDelays, tapFeedbacks, taps, 2);
+            float sampleRead = taps[0] * delay1Gain + taps[1] * delay2Gain;
             channelData[i] = channelData[i] + (sampleRead - channelData[i]) * currentBalance;
         }
 
@@ -84,7 +84,8 @@ private:
     std::atomic<float> *balanceParameter = nullptr;
     SmoothedValue<float> balanceSmoothed;
 
-    DelayLine delayLine[2];
+    DelayArena delayArena;
+    DelayLine<DelayLineInterpolation::Linear> delayLine[2];
 
     void computeDelayTime(float delayTime);
     void updateAmplitude();
@@ -151,7 +151,7 @@ void Plugex_20_flangerAudioProcessor::prepareToPlay (double sampleRate, int samp
 {
     currentSampleRate = sampleRate;
 
-    lfoPhase = 0.0f;
+    modulation.setup(sampleRate);
 
     freqSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     freqSmoothed.setCurrentAndTargetValue(*freqParameter);
@@ -160,9 +160,11 @@ void Plugex_20_flangerAudioProcessor::prepareToPlay (double sampleRate, int samp
     depthSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     depthSmoothed.setCurrentAndTargetValue(*depthParameter);
 
+    delayArena.clear();
     for (int channel = 0; channel < 2; channel++) {
-        delayLine[channel].setup(0.25f, currentSampleRate);
+        delayLine[channel].setup(delayArena, 0.02f, currentSampleRate, ModulatedDelay::maxBlockSize);
     }
+    delayArena.allocate();
 }
 
 void Plugex_20_flangerAudioProcessor::releaseResources()
@@ -208,24 +210,32 @@ void Plugex_20_flangerAudioProcessor::processBlock (AudioBuffer<float>& buffer,
     delaySmoothed.setTargetValue(*delayParameter);
     depthSmoothed.setTargetValue(*depthParameter);
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
+    // The LFO and the delays (in samples) of a whole chunk are computed
+    // first, then each channel reads its delay line over the chunk.
+    float frequencies[ModulatedDelay::maxBlockSize];
+    float delayedSamples[ModulatedDelay::maxBlockSize];
+
+    for (int start = 0; start < buffer.getNumSamples(); start += ModulatedDelay::maxBlockSize)
     {
-        float currentFreq = freqSmoothed.getNextValue();
-        float currentDelay = delaySmoothed.getNextValue() * 0.001f;
-        float currentDepth = depthSmoothed.getNextValue() * 0.0099f;
+        int chunkSize = jmin((int)ModulatedDelay::maxBlockSize, buffer.getNumSamples() - start);
 
-        float lfoDelayTime = sinf(lfoPhase * M_PI * 2) * (currentDelay * currentDepth) + currentDelay;
-        lfoPhase += currentFreq / currentSampleRate;
-        if (lfoPhase >= 1.0f) {
-            lfoPhase -= 1.0f;
+        for (int i = 0; i < chunkSize; i++) {
+            frequencies[i] = freqSmoothed.getNextValue();
         }
+        modulation.renderLfo(frequencies, chunkSize, ModulatedDelay::sine);
+        modulation.renderDelays(chunkSize, [this](float lfo) {
+            float currentDelay = delaySmoothed.getNextValue() * 0.001f * currentSampleRate;
+            float currentDepth = depthSmoothed.getNextValue() * 0.0099f;
+            return lfo * (currentDelay * currentDepth) + currentDelay;
+        });
 
         for (int channel = 0; channel < totalNumInputChannels; ++channel)
         {
-            float sampleRead = delayLine[channel].read(lfoDelayTime);
-            auto* channelData = buffer.getWritePointer (channel);
-            delayLine[channel].write(channelData[i]);
-            channelData[i] = channelData[i] + (sampleRead - channelData[i]) * 0.5f;
+            auto* channelData = buffer.getWritePointer (channel, start);
+            modulation.processDelay(delayLine[channel], channelData, delayedSamples, chunkSize);
+            for (int i = 0; i < chunkSize; i++) {
+                channelData[i] = channelData[i] + (delayedSamples[i] - channelData[i]) * 0.5f;
+            }
         }
     }
 }
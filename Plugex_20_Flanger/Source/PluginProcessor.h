@@ -13,6 +13,7 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "DelayLine.h"
+#include "ModulatedDelay.h"
 
 //==============================================================================
 /**
@@ -63,7 +64,7 @@ private:
 
     double currentSampleRate;
 
-    float lfoPhase;
+    ModulatedDelay modulation;
 
     std::atomic<float> *freqParameter = nullptr;
     SmoothedValue<float> freqSmoothed;
@@ -74,7 +75,8 @@ private:
     std::atomic<float> *depthParameter = nullptr;
     SmoothedValue<float> depthSmoothed;
 
-    DelayLine delayLine[2];
+    DelayArena delayArena;
+    DelayLine<DelayLineInterpolation::Allpass> delayLine[2];
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Plugex_20_flangerAudioProcessor)
 };
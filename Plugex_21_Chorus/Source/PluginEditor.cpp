@@ -18,7 +18,7 @@ Plugex_21_chorusAudioProcessorEditor::Plugex_21_chorusAudioProcessorEditor (Plug
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 200);
+    setSize (500, 200);
 
     setLookAndFeel(&plugexLookAndFeel);
     plugexLookAndFeel.setTheme("orange");
@@ -60,6 +60,17 @@ Plugex_21_chorusAudioProcessorEditor::Plugex_21_chorusAudioProcessorEditor (Plug
     addAndMakeVisible(&balanceKnob);
 
     balanceAttachment.reset(new AudioProcessorValueTreeState::SliderAttachment(valueTreeState, "balance", balanceKnob));
+
+    voicesLabel.setText("Voices", NotificationType::dontSendNotification);
+    voicesLabel.setJustificationType(Justification::horizontallyCentred);
+    addAndMakeVisible(&voicesLabel);
+
+    voicesKnob.setLookAndFeel(&plugexLookAndFeel);
+    voicesKnob.setSliderStyle(Slider::RotaryHorizontalVerticalDrag);
+    voicesKnob.setTextBoxStyle(Slider::TextBoxBelow, false, 80, 20);
+    addAndMakeVisible(&voicesKnob);
+
+    voicesAttachment.reset(new AudioProcessorValueTreeState::SliderAttachment(valueTreeState, "voices", voicesKnob));
 }
 
 Plugex_21_chorusAudioProcessorEditor::~Plugex_21_chorusAudioProcessorEditor()
@@ -67,6 +78,7 @@ Plugex_21_chorusAudioProcessorEditor::~Plugex_21_chorusAudioProcessorEditor()
     depthKnob.setLookAndFeel(nullptr);
     feedbackKnob.setLookAndFeel(nullptr);
     balanceKnob.setLookAndFeel(nullptr);
+    voicesKnob.setLookAndFeel(nullptr);
     setLookAndFeel(nullptr);
 }
 
@@ -86,17 +98,21 @@ void Plugex_21_chorusAudioProcessorEditor::resized()
     area.removeFromTop(12);
 
     auto area2 = area.removeFromTop(100);
-    auto depthArea = area2.removeFromLeft(width/3.0f).withSizeKeepingCentre(80, 100);
+    auto depthArea = area2.removeFromLeft(width/4.0f).withSizeKeepingCentre(80, 100);
     depthLabel.setBounds(depthArea.removeFromTop(20));
     depthKnob.setBounds(depthArea);
 
-    auto feedbackArea = area2.removeFromLeft(width/3.0f).withSizeKeepingCentre(80, 100);
+    auto feedbackArea = area2.removeFromLeft(width/4.0f).withSizeKeepingCentre(80, 100);
     feedbackLabel.setBounds(feedbackArea.removeFromTop(20));
     feedbackKnob.setBounds(feedbackArea);
 
-    auto balanceArea = area2.withSizeKeepingCentre(80, 100);
+    auto balanceArea = area2.removeFromLeft(width/4.0f).withSizeKeepingCentre(80, 100);
     balanceLabel.setBounds(balanceArea.removeFromTop(20));
     balanceKnob.setBounds(balanceArea);
 
+    auto voicesArea = area2.withSizeKeepingCentre(80, 100);
+    voicesLabel.setBounds(voicesArea.removeFromTop(20));
+    voicesKnob.setBounds(voicesArea);
+
     area.removeFromTop(12);
 }
@@ -50,6 +50,10 @@ private:
     Label  balanceLabel;
     Slider balanceKnob;
     std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> balanceAttachment;
+
+    Label  voicesLabel;
+    Slider voicesKnob;
+    std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> voicesAttachment;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Plugex_21_chorusAudioProcessorEditor)
 };
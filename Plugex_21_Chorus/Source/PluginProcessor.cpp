@@ -25,6 +25,14 @@ static float depthSliderTextToValue(const String& text) {
     return text.getFloatValue();
 }
 
+static String voicesSliderValueToText(float value) {
+    return String((int)value);
+}
+
+static float voicesSliderTextToValue(const String& text) {
+    return text.getFloatValue();
+}
+
 AudioProcessorValueTreeState::ParameterLayout createParameterLayout() {
     using Parameter = AudioProcessorValueTreeState::Parameter;
 
@@ -42,6 +50,10 @@ AudioProcessorValueTreeState::ParameterLayout createParameterLayout() {
                                                      NormalisableRange<float>(0.0f, 100.0f, 0.01f, 1.0f),
                                                      50.0f, depthSliderValueToText, depthSliderTextToValue));
 
+    parameters.push_back(std::make_unique<Parameter>(String("voices"), String("Voices"), String(),
+                                                     NormalisableRange<float>(4.0f, 32.0f, 1.f, 1.0f),
+                                                     8.0f, voicesSliderValueToText, voicesSliderTextToValue));
+
     return { parameters.begin(), parameters.end() };
 }
 
@@ -62,6 +74,7 @@ Plugex_21_chorusAudioProcessor::Plugex_21_chorusAudioProcessor()
     depthParameter = parameters.getRawParameterValue("depth");
     feedbackParameter = parameters.getRawParameterValue("feedback");
     balanceParameter = parameters.getRawParameterValue("balance");
+    voicesParameter = parameters.getRawParameterValue("voices");
 }
 
 Plugex_21_chorusAudioProcessor::~Plugex_21_chorusAudioProcessor()
@@ -142,15 +155,8 @@ void Plugex_21_chorusAudioProcessor::prepareToPlay (double sampleRate, int sampl
     balanceSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     balanceSmoothed.setCurrentAndTargetValue(*balanceParameter);
 
-    float srFactor = currentSampleRate / 44100.f;
-
-    for (int line = 0; line < 8; line++) {
-        for (int channel = 0; channel < 2; channel++) {
-            lfoDelayTime[line][channel].setup(currentSampleRate);
-            float delayLineLength = (centerDelayTimes[0] * srFactor * 2.f + 0.005f);
-            delayLine[line][channel].setup(delayLineLength, currentSampleRate);
-        }
-    }
+    chorus.setup(currentSampleRate);
+    chorus.setNumberOfVoices((int)*voicesParameter);
 }
 
 void Plugex_21_chorusAudioProcessor::releaseResources()
@@ -195,6 +201,7 @@ void Plugex_21_chorusAudioProcessor::processBlock (AudioBuffer<float>& buffer, M
     depthSmoothed.setTargetValue(*depthParameter);
     feedbackSmoothed.setTargetValue(*feedbackParameter);
     balanceSmoothed.setTargetValue(*balanceParameter);
+    chorus.setNumberOfVoices((int)*voicesParameter);
 
     for (int i = 0; i < buffer.getNumSamples(); i++) {
         float currentDepth = depthSmoothed.getNextValue() * 0.02;
@@ -202,16 +209,8 @@ void Plugex_21_chorusAudioProcessor::processBlock (AudioBuffer<float>& buffer, M
         float currentBalance = balanceSmoothed.getNextValue() * 0.01;
 
         for (int channel = 0; channel < totalNumInputChannels; ++channel) {
-            float totalSignal = 0.f;
             auto* channelData = buffer.getWritePointer (channel);
-            for (int line = 0; line < 8; line++) {
-                lfoDelayTime[line][channel].setFreq(lfoFrequencies[line] + channel * 0.01f);
-                float delayTime = delayTimeDevs[line] * currentDepth * lfoDelayTime[line][channel].process() + centerDelayTimes[line];
-                float sampleRead = delayLine[line][channel].read(delayTime);
-                delayLine[line][channel].write(channelData[i] + sampleRead * currentFeedback);
-                totalSignal += sampleRead;
-            }
-            totalSignal *= 0.25;
+            float totalSignal = chorus.process(channel, channelData[i], currentDepth, currentFeedback);
             channelData[i] = channelData[i] + (totalSignal - channelData[i]) * currentBalance;
         }
     }
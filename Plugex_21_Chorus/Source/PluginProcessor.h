@@ -12,8 +12,7 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
-#include "DelayLine.h"
-#include "SinOsc.h"
+#include "ChorusEngine.h"
 
 //==============================================================================
 /**
@@ -62,10 +61,6 @@ private:
     //==============================================================================
     AudioProcessorValueTreeState parameters;
 
-    const float centerDelayTimes[8] = {0.0087, 0.0102, 0.011, 0.0125, 0.0134, 0.015, 0.0171, 0.0178};
-    const float delayTimeDevs[8] = {0.001, 0.0012, 0.0013, 0.0014, 0.0015, 0.0016, 0.002, 0.0023};
-    const float lfoFrequencies[8] = {1.879, 1.654, 1.342, 1.231, 0.879, 0.657, 0.465, 0.254};
-    
     double currentSampleRate;
 
     std::atomic<float> *depthParameter = nullptr;
@@ -77,8 +72,9 @@ private:
     std::atomic<float> *balanceParameter = nullptr;
     SmoothedValue<float> balanceSmoothed;
 
-    SinOsc lfoDelayTime[8][2];
-    DelayLine delayLine[8][2];
+    std::atomic<float> *voicesParameter = nullptr;
+
+    ChorusEngine chorus;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Plugex_21_chorusAudioProcessor)
 };
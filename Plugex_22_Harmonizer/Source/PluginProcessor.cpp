@@ -167,10 +167,12 @@ void Plugex_22_harmonizerAudioProcessor::prepareToPlay (double sampleRate, int s
     balanceSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     balanceSmoothed.setCurrentAndTargetValue(*balanceParameter);
 
+    delayArena.clear();
     for (int channel = 0; channel < 2; channel++) {
-        delayLine[channel].setup(0.25f, currentSampleRate);
+        delayLine[channel].setup(delayArena, 0.2f, currentSampleRate);
         dcFilterLastInput[channel] = dcFilterLastOutput[channel] = 0.0f;
     }
+    delayArena.allocate();
 }
 
 void Plugex_22_harmonizerAudioProcessor::releaseResources()
@@ -232,11 +234,15 @@ void Plugex_22_harmonizerAudioProcessor::processBlock (AudioBuffer<float>& buffe
         float secondOverlapAmp = sinf(fmod(runningPhase + 0.5f, 1.0f) * M_PI);
         float firstOverlapDelay = runningPhase * currentWinsize;
         float secondOverlapDelay = fmod(runningPhase + 0.5f, 1.0f) * currentWinsize;
+        float tapDelays[2];
+        tapDelays[0] = firstOverlapDelay * currentSampleRate;
+        tapDelays[1] = secondOverlapDelay * currentSampleRate;
     
         for (int channel = 0; channel < totalNumInputChannels; ++channel)
         {
-            float sampleRead = delayLine[channel].read(firstOverlapDelay) * firstOverlapAmp;
-            sampleRead += delayLine[channel].read(secondOverlapDelay) * secondOverlapAmp;
+            float taps[2];
+            delayLine[channel].readTaps(tapDelays, taps, 2);
+            float sampleRead = taps[0] * firstOverlapAmp + taps[1] * secondOverlapAmp;
             auto* channelData = buffer.getWritePointer (channel);
             dcFilterLastOutput[channel] = sampleRead - dcFilterLastInput[channel] + 0.995 * dcFilterLastOutput[channel];
             dcFilterLastInput[channel] = sampleRead;
@@ -79,7 +79,8 @@ private:
     std::atomic<float> *balanceParameter = nullptr;
     SmoothedValue<float> balanceSmoothed;
 
-    DelayLine delayLine[2];
+    DelayArena delayArena;
+    DelayLine<DelayLineInterpolation::Hermite> delayLine[2];
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Plugex_22_harmonizerAudioProcessor)
 };
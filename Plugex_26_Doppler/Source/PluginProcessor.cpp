@@ -138,14 +138,17 @@ void Plugex_26_dopplerAudioProcessor::prepareToPlay (double sampleRate, int samp
 {
     currentSampleRate = sampleRate;
 
-    lfoPhase = 0.0f;
+    modulation.setup(sampleRate);
 
     freqSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     freqSmoothed.setCurrentAndTargetValue(*freqParameter);
     depthSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     depthSmoothed.setCurrentAndTargetValue(*depthParameter);
 
-    delayLine.setup(sampleRate / 2.f, currentSampleRate);
+    delayArena.clear();
+    // Longest delay: 0.5 s at full depth, plus 1 ms.
+    delayLine.setup(delayArena, 0.5f, currentSampleRate, ModulatedDelay::maxBlockSize);
+    delayArena.allocate();
     lowpassFilter.setup(sampleRate);
     lowpassFilter.setType(0);
     lowpassFilter.setQ(0.707);
@@ -197,39 +200,41 @@ void Plugex_26_dopplerAudioProcessor::processBlock (AudioBuffer<float>& buffer,
         return;
     }
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
+    // The triangle LFO, the pan gains and the delays (in samples) of a whole
+    // chunk are computed first, the filter frequency follows the LFO at the
+    // control points.
+    float frequencies[ModulatedDelay::maxBlockSize];
+    float sumValues[ModulatedDelay::maxBlockSize];
+    float delayedSamples[ModulatedDelay::maxBlockSize];
+
+    for (int start = 0; start < buffer.getNumSamples(); start += ModulatedDelay::maxBlockSize)
     {
-        float currentFreq = freqSmoothed.getNextValue();
-        float currentDepth = depthSmoothed.getNextValue() * 0.0099f;
+        int chunkSize = jmin((int)ModulatedDelay::maxBlockSize, buffer.getNumSamples() - start);
 
-        float sumValue = 0.0f;
-        if (totalNumInputChannels == 1) {
-            sumValue = buffer.getWritePointer(0)[i];
-        } else {
-            for (int channel = 0; channel < totalNumInputChannels; ++channel) {
-                auto* channelData = buffer.getWritePointer (channel);
-                sumValue += channelData[i];
-            }
+        for (int i = 0; i < chunkSize; i++) {
+            frequencies[i] = freqSmoothed.getNextValue();
         }
+        modulation.renderLfo(frequencies, chunkSize, ModulatedDelay::triangle);
 
-        float lfo = jmin(lfoPhase, 1.f - lfoPhase) * 2.f;
-        float delayTime = (0.5f - jmin(lfo, 1.f - lfo));
-        float filterFreq = powf(jmin(lfo, 1.f - lfo), 2.f) * 20000.f + 200.f;
-
-        auto* channelDataL = buffer.getWritePointer(0);
-        auto* channelDataR = buffer.getWritePointer(1);
+        auto* channelDataL = buffer.getWritePointer(0, start);
+        auto* channelDataR = buffer.getWritePointer(1, start);
 
-        lfoPhase += currentFreq / currentSampleRate;
-        if (lfoPhase >= 1.0f) {
-            lfoPhase -= 1.0f;
+        FloatVectorOperations::copy(sumValues, buffer.getReadPointer(0, start), chunkSize);
+        for (int channel = 1; channel < totalNumInputChannels; ++channel) {
+            FloatVectorOperations::add(sumValues, buffer.getReadPointer(channel, start), chunkSize);
         }
 
-        float sampleRead = delayLine.read(delayTime * currentDepth + 0.001f);
-        delayLine.write(sumValue);
-        lowpassFilter.setFreq(filterFreq);
-        float filtered = lowpassFilter.process(sampleRead);
-        channelDataL[i] = filtered * cosf(lfo * M_PI * 0.5f);
-        channelDataR[i] = filtered * sinf(lfo * M_PI * 0.5f);
+        modulation.renderDelays(chunkSize, [this](float lfo) {
+            float currentDepth = depthSmoothed.getNextValue() * 0.0099f;
+            float delayTime = (0.5f - jmin(lfo, 1.f - lfo));
+            return (delayTime * currentDepth + 0.001f) * currentSampleRate;
+        });
+        modulation.processDelay(delayLine, sumValues, delayedSamples, chunkSize);
+        modulation.processFilter(lowpassFilter, delayedSamples, chunkSize, [](float lfo) {
+            float distance = jmin(lfo, 1.f - lfo);
+            return distance * distance * 20000.f + 200.f;
+        });
+        modulation.processPan(delayedSamples, channelDataL, channelDataR, chunkSize);
     }
 }
 
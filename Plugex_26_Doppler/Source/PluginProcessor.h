@@ -13,6 +13,7 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "DelayLine.h"
+#include "ModulatedDelay.h"
 #include "Biquad.h"
 
 //==============================================================================
@@ -64,7 +65,7 @@ private:
 
     double currentSampleRate;
 
-    float lfoPhase;
+    ModulatedDelay modulation;
 
     std::atomic<float> *freqParameter = nullptr;
     SmoothedValue<float> freqSmoothed;
@@ -72,7 +73,8 @@ private:
     std::atomic<float> *depthParameter = nullptr;
     SmoothedValue<float> depthSmoothed;
 
-    DelayLine delayLine;
+    DelayArena delayArena;
+    DelayLine<DelayLineInterpolation::Hermite> delayLine;
     Biquad    lowpassFilter;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Plugex_26_dopplerAudioProcessor)
@@ -16,6 +16,9 @@
 #define M_PI (3.14159265358979323846264338327950288)
 #endif
 
+// The look ahead delay is written and read by chunks of this many samples.
+static const int lookaheadBlockSize = 256;
+
 static String threshSliderValueToText(float value) {
     return String(value, 2) + String(" dB");
 }
@@ -164,11 +167,13 @@ void Plugex_28_gateAudioProcessor::prepareToPlay (double sampleRate, int samples
     lookaheadSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     lookaheadSmoothed.setCurrentAndTargetValue(*lookaheadParameter);
 
+    delayArena.clear();
     for (int channel = 0; channel < 2; channel++) {
         lowpassFilter[channel].setup(currentSampleRate);
         gateFilter[channel].setup(currentSampleRate);
-        lookaheadDelay[channel].setup(0.015, currentSampleRate);
+        lookaheadDelay[channel].setup(delayArena, 0.015, currentSampleRate, lookaheadBlockSize);
     }
+    delayArena.allocate();
 }
 
 void Plugex_28_gateAudioProcessor::releaseResources()
@@ -215,12 +220,35 @@ void Plugex_28_gateAudioProcessor::processBlock (AudioBuffer<float>& buffer, Mid
     falltimeSmoothed.setTargetValue(*falltimeParameter);
     lookaheadSmoothed.setTargetValue(*lookaheadParameter);
 
+    float lookaheadSamples[lookaheadBlockSize];
+    float delayedSamples[2][lookaheadBlockSize];
+
     for (int i = 0; i < buffer.getNumSamples(); i++)
     {
+        /* Look ahead, one chunk at a time, before the input is replaced */
+        int chunkIndex = i % lookaheadBlockSize;
+        if (chunkIndex == 0) {
+            int chunkSize = jmin(lookaheadBlockSize, buffer.getNumSamples() - i);
+            /* A steady lookahead is a whole number of samples, read as a block copy */
+            bool steady = ! lookaheadSmoothed.isSmoothing();
+            float steadyLookahead = (int)(lookaheadSmoothed.getTargetValue() * 0.001f * currentSampleRate);
+            if (! steady) {
+                for (int j = 0; j < chunkSize; j++) {
+                    lookaheadSamples[j] = lookaheadSmoothed.getNextValue() * 0.001f * currentSampleRate;
+                }
+            }
+            for (int channel = 0; channel < totalNumInputChannels; ++channel) {
+                lookaheadDelay[channel].writeBlock(buffer.getReadPointer(channel, i), chunkSize);
+                if (steady)
+                    lookaheadDelay[channel].readBlock(delayedSamples[channel], chunkSize, steadyLookahead);
+                else
+                    lookaheadDelay[channel].readBlock(delayedSamples[channel], chunkSize, lookaheadSamples);
+            }
+        }
+
         float thresh = powf(10.0f, threshSmoothed.getNextValue() * 0.05f);
         float risetime = risetimeSmoothed.getNextValue() * 0.001f;
         float falltime = falltimeSmoothed.getNextValue() * 0.001f;
-        float lookahead = lookaheadSmoothed.getNextValue() * 0.001f;
 
         for (int channel = 0; channel < totalNumInputChannels; ++channel) {
             auto* channelData = buffer.getWritePointer (channel);
@@ -237,8 +265,7 @@ void Plugex_28_gateAudioProcessor::processBlock (AudioBuffer<float>& buffer, Mid
                 gate = gateFilter[channel].process(0.0f);
             }
 
-            float delayedSample = lookaheadDelay[channel].read(lookahead);
-            lookaheadDelay[channel].write(channelData[i]);
+            float delayedSample = delayedSamples[channel][chunkIndex];
             channelData[i] = delayedSample * gate;
         }
     }
@@ -78,7 +78,8 @@ private:
 
     OnePoleLowpass lowpassFilter[2];
     OnePoleLowpass gateFilter[2];
-    DelayLine      lookaheadDelay[2];
+    DelayArena delayArena;
+    DelayLine<DelayLineInterpolation::None> lookaheadDelay[2];
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Plugex_28_gateAudioProcessor)
 };
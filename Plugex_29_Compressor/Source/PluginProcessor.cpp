@@ -16,6 +16,9 @@
 #define M_PI (3.14159265358979323846264338327950288)
 #endif
 
+// The look ahead delay is written and read by chunks of this many samples.
+static const int lookaheadBlockSize = 256;
+
 static String threshSliderValueToText(float value) {
     return String(value, 2) + String(" dB");
 }
@@ -180,9 +183,11 @@ void Plugex_29_compressorAudioProcessor::prepareToPlay (double sampleRate, int s
     lookaheadSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     lookaheadSmoothed.setCurrentAndTargetValue(*lookaheadParameter);
 
+    delayArena.clear();
     for (int channel = 0; channel < 2; channel++) {
-        lookaheadDelay[channel].setup(0.015, currentSampleRate);
+        lookaheadDelay[channel].setup(delayArena, 0.015, currentSampleRate, lookaheadBlockSize);
     }
+    delayArena.allocate();
 }
 
 void Plugex_29_compressorAudioProcessor::releaseResources()
@@ -230,13 +235,36 @@ void Plugex_29_compressorAudioProcessor::processBlock (AudioBuffer<float>& buffe
     falltimeSmoothed.setTargetValue(*falltimeParameter);
     lookaheadSmoothed.setTargetValue(*lookaheadParameter);
 
+    float lookaheadSamples[lookaheadBlockSize];
+    float delayedSamples[2][lookaheadBlockSize];
+
     for (int i = 0; i < buffer.getNumSamples(); i++)
     {
+        /* Look ahead, one chunk at a time, before the input is replaced */
+        int chunkIndex = i % lookaheadBlockSize;
+        if (chunkIndex == 0) {
+            int chunkSize = jmin(lookaheadBlockSize, buffer.getNumSamples() - i);
+            /* A steady lookahead is a whole number of samples, read as a block copy */
+            bool steady = ! lookaheadSmoothed.isSmoothing();
+            float steadyLookahead = (int)(lookaheadSmoothed.getTargetValue() * 0.001f * currentSampleRate);
+            if (! steady) {
+                for (int j = 0; j < chunkSize; j++) {
+                    lookaheadSamples[j] = lookaheadSmoothed.getNextValue() * 0.001f * currentSampleRate;
+                }
+            }
+            for (int channel = 0; channel < totalNumInputChannels; ++channel) {
+                lookaheadDelay[channel].writeBlock(buffer.getReadPointer(channel, i), chunkSize);
+                if (steady)
+                    lookaheadDelay[channel].readBlock(delayedSamples[channel], chunkSize, steadyLookahead);
+                else
+                    lookaheadDelay[channel].readBlock(delayedSamples[channel], chunkSize, lookaheadSamples);
+            }
+        }
+
         float thresh = threshSmoothed.getNextValue();
         float ratio = ratioSmoothed.getNextValue();
         float risetime = risetimeSmoothed.getNextValue() * 0.001f;
         float falltime = falltimeSmoothed.getNextValue() * 0.001f;
-        float lookahead = lookaheadSmoothed.getNextValue() * 0.001f;
 
         ratio = 1.0f / ratio;
         risetime = expf(-1.0f / (currentSampleRate * risetime));
@@ -261,8 +289,7 @@ void Plugex_29_compressorAudioProcessor::processBlock (AudioBuffer<float>& buffe
             }
 
             /* Look ahead */
-            float delayedSample = lookaheadDelay[channel].read(lookahead);
-            lookaheadDelay[channel].write(channelData[i]);
+            float delayedSample = delayedSamples[channel][chunkIndex];
 
             /* Compress signal */
             float outAmplitude = 1.0f;
@@ -79,7 +79,8 @@ private:
     std::atomic<float> *lookaheadParameter = nullptr;
     SmoothedValue<float> lookaheadSmoothed;
 
-    DelayLine lookaheadDelay[2];
+    DelayArena delayArena;
+    DelayLine<DelayLineInterpolation::None> lookaheadDelay[2];
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Plugex_29_compressorAudioProcessor)
 };
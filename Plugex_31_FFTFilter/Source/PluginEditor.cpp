@@ -17,7 +17,7 @@ Plugex_31_fftFilterAudioProcessorEditor::Plugex_31_fftFilterAudioProcessorEditor
                                                                                       AudioProcessorValueTreeState& vts)
     : AudioProcessorEditor (&p), processor (p), valueTreeState (vts)
 {
-    setSize (400, 300);
+    setSize (500, 300);
 
     setLookAndFeel(&plugexLookAndFeel);
     plugexLookAndFeel.setTheme("steal");
@@ -27,6 +27,17 @@ Plugex_31_fftFilterAudioProcessorEditor::Plugex_31_fftFilterAudioProcessorEditor
     title.setJustificationType(Justification::horizontallyCentred);
     addAndMakeVisible(&title);
 
+    modeLabel.setText("Mode", NotificationType::dontSendNotification);
+    modeLabel.setJustificationType(Justification::horizontallyCentred);
+    addAndMakeVisible(&modeLabel);
+
+    modeCombo.setLookAndFeel(&plugexLookAndFeel);
+    modeCombo.addItemList({"FFT", "Min Phase FIR", "Linear Phase FIR"}, 1);
+    modeCombo.setSelectedId(1);
+    addAndMakeVisible(&modeCombo);
+
+    modeAttachment.reset(new AudioProcessorValueTreeState::ComboBoxAttachment(valueTreeState, "mode", modeCombo));
+
     orderLabel.setText("FFT Size", NotificationType::dontSendNotification);
     orderLabel.setJustificationType(Justification::horizontallyCentred);
     addAndMakeVisible(&orderLabel);
@@ -76,6 +87,7 @@ Plugex_31_fftFilterAudioProcessorEditor::Plugex_31_fftFilterAudioProcessorEditor
 
 Plugex_31_fftFilterAudioProcessorEditor::~Plugex_31_fftFilterAudioProcessorEditor()
 {
+    modeCombo.setLookAndFeel(nullptr);
     orderCombo.setLookAndFeel(nullptr);
     overlapsCombo.setLookAndFeel(nullptr);
     wintypeCombo.setLookAndFeel(nullptr);
@@ -108,16 +120,20 @@ void Plugex_31_fftFilterAudioProcessorEditor::resized()
     area.removeFromTop(12);
 
     auto area2 = area.removeFromTop(60);
-    auto orderArea = area2.removeFromLeft(width / 3.0f);
+    auto modeArea = area2.removeFromLeft(width / 4.0f);
+    modeLabel.setBounds(modeArea.removeFromTop(20));
+    modeCombo.setBounds(modeArea.removeFromTop(60).withSizeKeepingCentre(110, 24));
+
+    auto orderArea = area2.removeFromLeft(width / 4.0f);
     orderLabel.setBounds(orderArea.removeFromTop(20));
-    orderCombo.setBounds(orderArea.removeFromTop(60).withSizeKeepingCentre(120, 24));
+    orderCombo.setBounds(orderArea.removeFromTop(60).withSizeKeepingCentre(110, 24));
 
-    auto overlapsArea = area2.removeFromLeft(width / 3.0f);
+    auto overlapsArea = area2.removeFromLeft(width / 4.0f);
     overlapsLabel.setBounds(overlapsArea.removeFromTop(20));
-    overlapsCombo.setBounds(overlapsArea.removeFromTop(60).withSizeKeepingCentre(120, 24));
+    overlapsCombo.setBounds(overlapsArea.removeFromTop(60).withSizeKeepingCentre(110, 24));
 
     wintypeLabel.setBounds(area2.removeFromTop(20));
-    wintypeCombo.setBounds(area2.removeFromTop(60).withSizeKeepingCentre(120, 24));
+    wintypeCombo.setBounds(area2.removeFromTop(60).withSizeKeepingCentre(110, 24));
 
     area.removeFromTop(12);
     filterLabel.setBounds(area.removeFromTop(20).withSizeKeepingCentre(getWidth() - 20, 20));
@@ -39,6 +39,10 @@ private:
 
     Label title;
 
+    Label modeLabel;
+    ComboBox modeCombo;
+    std::unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> modeAttachment;
+
     Label orderLabel;
     ComboBox orderCombo;
     std::unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> orderAttachment;
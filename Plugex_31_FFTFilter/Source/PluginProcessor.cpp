@@ -33,6 +33,11 @@ AudioProcessorValueTreeState::ParameterLayout createParameterLayout() {
                                                      NormalisableRange<float>(1.0f, 9.0f, 1.f, 1.0f),
                                                      3.0f, nullptr, nullptr));
 
+    // Appended last, so hosts keep the parameter indices of older sessions.
+    parameters.push_back(std::make_unique<Parameter>(String("mode"), String("Mode"), String(),
+                                                     NormalisableRange<float>(0.0f, 2.0f, 1.f, 1.0f),
+                                                     0.0f, nullptr, nullptr));
+
     return { parameters.begin(), parameters.end() };
 }
 
@@ -50,10 +55,12 @@ Plugex_31_fftFilterAudioProcessor::Plugex_31_fftFilterAudioProcessor()
 #endif
     parameters (*this, nullptr, Identifier(JucePlugin_Name), createParameterLayout())
 {
+    modeParameter = parameters.getRawParameterValue("mode");
     orderParameter = parameters.getRawParameterValue("order");
     overlapsParameter = parameters.getRawParameterValue("overlaps");
     wintypeParameter = parameters.getRawParameterValue("wintype");
 
+    lastMode = (int)*modeParameter;
     lastOrder = (int)*orderParameter;
     lastOverlaps = 1 << (int)*overlapsParameter;
     lastWintype = (int)*overlapsParameter;
@@ -64,15 +71,25 @@ Plugex_31_fftFilterAudioProcessor::Plugex_31_fftFilterAudioProcessor()
     }
     parameters.state.addChild(filterNode, -1, nullptr);
 
-    for (auto channel = 0; channel < 2; channel++) {
-        fftEngine[channel].setup(lastOrder, lastOverlaps, lastWintype);
-        fftEngine[channel].addListener(this);
-    }
+    // Spreads each frame over the next hop, large orders no longer produce CPU spikes.
+    fftEngine.setAmortized(true);
+    // The filter is a plain gain per bin, applied on contiguous real and imaginary arrays.
+    fftEngine.setSplitComplex(true);
+    fftEngine.setup(lastOrder, lastOverlaps, lastWintype);
+    fftEngine.addListener(this);
+    startTimer(50);
 
-    zeromem (fftFilter, sizeof (fftFilter));
+    // Avoids zipper noise while the curve is being drawn.
+    fftFilter.setSmoothing(0.5f);
 
     fftFilterPoints.resize(filterNumberOfPoints);
     fftFilterPoints.fill(0.0f);
+
+    // In FIR modes, the FFT size control sets the kernel length.
+    convolver.setKernelOrder(lastOrder);
+    convolver.setMinimumPhase(lastMode != 2);
+    computeFFTFilter();
+    computeConvolutionResponse();
 }
 
 Plugex_31_fftFilterAudioProcessor::~Plugex_31_fftFilterAudioProcessor()
@@ -146,6 +163,11 @@ void Plugex_31_fftFilterAudioProcessor::prepareToPlay (double sampleRate, int sa
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    int maxOrder = (int) parameters.getParameterRange("order").end;
+    fftEngine.prepare(maxOrder, getTotalNumInputChannels() == 2);
+    convolver.prepare(getTotalNumInputChannels(), 7, maxOrder);
+    updateLatency();
+    setLatencySamples(pendingLatency);
 }
 
 void Plugex_31_fftFilterAudioProcessor::releaseResources()
@@ -179,13 +201,7 @@ bool Plugex_31_fftFilterAudioProcessor::isBusesLayoutSupported (const BusesLayou
 #endif
 
 void Plugex_31_fftFilterAudioProcessor::computeFFTFilter() {
-    int filterSize = fftEngine[0].getSize() / 2 + 1;
-    for (int i = 0; i < filterSize; i++) {
-        float index = sinf(i / (float)filterSize * M_PI / 2.0f) * filterNumberOfPoints;
-        int ipart = (int)index;
-        float fpart = index - ipart;
-        fftFilter[i] = fftFilterPoints[ipart] + (fftFilterPoints[ipart+1] - fftFilterPoints[ipart]) * fpart;
-    }
+    fftFilter.setPoints(fftFilterPoints);
 }
 
 void Plugex_31_fftFilterAudioProcessor::setFFTFilterPoints(const Array<float> &value) {
@@ -199,16 +215,42 @@ void Plugex_31_fftFilterAudioProcessor::setFFTFilterPoints(const Array<float> &v
     }
 
     computeFFTFilter();
+    computeConvolutionResponse();
 }
 
-void Plugex_31_fftFilterAudioProcessor::fftEngineFrameReady(FFTEngine *engine, float *fftData, int fftSize) {
-    for (int j = 0; j < fftSize / 2 + 1; j++) {
-        float gain = fftFilter[j];
-        fftData[j*2] *= gain;
-        fftData[j*2+1] *= gain;
+void Plugex_31_fftFilterAudioProcessor::computeConvolutionResponse() {
+    // Same frequency warping as the FFT filter, on the finest grid the FIR can use.
+    SpectralCurve::computeTable(fftFilterPoints, convolutionResponse, SpectralCurve::tableSize);
+    convolver.setResponse(convolutionResponse, SpectralCurve::tableSize);
+}
+
+void Plugex_31_fftFilterAudioProcessor::updateLatency() {
+    // Called from the audio thread, the timer reports the new latency.
+    if (lastMode == 0) {
+        pendingLatency = fftEngine.getLatencyInSamples();
+    } else {
+        pendingLatency = convolver.getLatencyInSamples();
     }
 }
 
+void Plugex_31_fftFilterAudioProcessor::timerCallback() {
+    int latency = pendingLatency.load();
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
+
+void Plugex_31_fftFilterAudioProcessor::fftEngineSplitFrameReady(FFTEngine *engine, int channel, float *real, float *imag, int fftSize) {
+    // Both channels of a frame share the gains picked up for the first one.
+    if (channel == 0) {
+        filterGains = fftFilter.getCurve(fftSize / 2 + 1);
+    }
+    SpectralOps::multiply(real, imag, filterGains, fftSize / 2 + 1);
+}
+
+void Plugex_31_fftFilterAudioProcessor::fftEngineSetupChanged(FFTEngine *engine) {
+    updateLatency();
+}
+
 void Plugex_31_fftFilterAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
     ScopedNoDenormals noDenormals;
@@ -218,22 +260,41 @@ void Plugex_31_fftFilterAudioProcessor::processBlock (AudioBuffer<float>& buffer
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
+    int mode = (int) *modeParameter;
     int order = (int) *orderParameter;
     int overlaps = 1 << (int) *overlapsParameter;
     int wintype = (int) *wintypeParameter;
 
-    for (auto channel = 0; channel < totalNumInputChannels; channel++) {
-        if (order != lastOrder || overlaps != lastOverlaps) {
-            fftEngine[channel].setup(order, overlaps, wintype);
-            computeFFTFilter();
-        }
-        if (wintype != lastWintype) {
-            fftEngine[channel].setWintype(wintype);
-        }
-        auto *channelData = buffer.getWritePointer(channel);
-        for (int i = 0; i < buffer.getNumSamples(); i++) {
-            channelData[i] = fftEngine[channel].process(channelData[i]);
+    if (order != lastOrder || overlaps != lastOverlaps) {
+        fftEngine.setup(order, overlaps, wintype);
+    }
+    if (wintype != lastWintype) {
+        fftEngine.setWintype(wintype);
+    }
+
+    if (mode != lastMode) {
+        convolver.setMinimumPhase(mode != 2);
+        fftEngine.reset();
+        convolver.reset();
+        lastMode = mode;
+        updateLatency();
+    }
+
+    if (mode != 0) {
+        convolver.setKernelOrder(order);
+        if (order != lastOrder) {
+            updateLatency();
         }
+        convolver.processBlock(buffer.getArrayOfWritePointers(), totalNumInputChannels, buffer.getNumSamples());
+    }
+    // A stereo-linked engine transforms both channels with a single complex FFT.
+    else if (fftEngine.getNumChannels() == 2) {
+        auto *leftData = buffer.getWritePointer(0);
+        auto *rightData = buffer.getWritePointer(1);
+        fftEngine.processBlock(leftData, rightData, leftData, rightData, buffer.getNumSamples());
+    } else {
+        auto *channelData = buffer.getWritePointer(0);
+        fftEngine.processBlock(channelData, channelData, buffer.getNumSamples());
     }
     lastOrder = order;
     lastOverlaps = overlaps;
@@ -280,6 +341,7 @@ void Plugex_31_fftFilterAudioProcessor::setStateInformation (const void* data, i
             fftFilterPoints.set(i, (float) filterNode.getProperty(Identifier(String(i)), 0.0f));
         }
         computeFFTFilter();
+        computeConvolutionResponse();
         fftFilterPointsChanged = true;
     }
 }
@@ -13,11 +13,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "FFTEngine.h"
+#include "PartitionedConvolver.h"
+#include "SpectralOps.h"
+#include "SpectralCurve.h"
 
 const int filterNumberOfPoints = 350;
 
 class Plugex_31_fftFilterAudioProcessor  : public AudioProcessor,
-                                             public FFTEngine::Listener
+                                             public FFTEngine::Listener,
+                                             public Timer
 {
 public:
     //==============================================================================
@@ -57,9 +61,14 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    void fftEngineFrameReady(FFTEngine *engine, float *fftData, int fftSize) override;
+    void fftEngineSplitFrameReady(FFTEngine *engine, int channel, float *real, float *imag, int fftSize) override;
+    void fftEngineSetupChanged(FFTEngine *engine) override;
+
+    void timerCallback() override;
 
     void computeFFTFilter();
+    void computeConvolutionResponse();
+    void updateLatency();
     void setFFTFilterPoints(const Array<float> &value);
 
     bool fftFilterPointsChanged = false;
@@ -69,13 +78,24 @@ private:
     //==============================================================================
     AudioProcessorValueTreeState parameters;
 
-    FFTEngine fftEngine[2];
-    float fftFilter[8193];
+    FFTEngine fftEngine;
+    // Published by the message thread, read at each frame by the audio thread.
+    SpectralCurve fftFilter;
+    const float *filterGains = nullptr;
+
+    // Low latency alternative to the STFT, using the same drawn response as a FIR.
+    PartitionedConvolver convolver;
+    float convolutionResponse[SpectralCurve::tableSize];
 
+    int lastMode;
     int lastOrder;
     int lastOverlaps;
     int lastWintype;
 
+    // Latency of the active mode, reported to the host from the message thread.
+    std::atomic<int> pendingLatency { 0 };
+
+    std::atomic<float> *modeParameter = nullptr;
     std::atomic<float> *orderParameter = nullptr;
     std::atomic<float> *overlapsParameter = nullptr;
     std::atomic<float> *wintypeParameter = nullptr;
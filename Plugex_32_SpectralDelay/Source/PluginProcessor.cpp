@@ -70,19 +70,22 @@ Plugex_32_spectralDelayAudioProcessor::Plugex_32_spectralDelayAudioProcessor()
     }
     parameters.state.addChild(feedbackNode, -1, nullptr);
 
-    for (auto channel = 0; channel < 2; channel++) {
-        fftEngine[channel].setup(lastOrder, lastOverlaps, lastWintype);
-        fftEngine[channel].addListener(this);
-    }
+    // Spreads each frame over the next hop, large orders no longer produce CPU spikes.
+    fftEngine.setAmortized(true);
+    fftEngine.setSplitComplex(true);
+    fftEngine.setup(lastOrder, lastOverlaps, lastWintype);
+    fftEngine.addListener(this);
+    startTimer(50);
 
-    zeromem (fftDelay, sizeof (fftDelay));
-    zeromem (fftFeedback, sizeof (fftFeedback));
 
     delayPoints.resize(multiSliderNumberOfPoints);
     delayPoints.fill(0.0f);
 
     feedbackPoints.resize(multiSliderNumberOfPoints);
     feedbackPoints.fill(0.0f);
+
+    computeFFTDelay();
+    computeFFTFeedback();
 }
 
 Plugex_32_spectralDelayAudioProcessor::~Plugex_32_spectralDelayAudioProcessor()
@@ -157,7 +160,30 @@ void Plugex_32_spectralDelayAudioProcessor::prepareToPlay (double sampleRate, in
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
     currentSampleRate = sampleRate;
-    resizeBuffers(lastOrder, lastOverlaps);
+
+    // Allocates for the largest setup (bins * frames peaks at the smallest
+    // order with the largest overlap), so that switching setup never has to
+    // resize the delay lines on the audio thread.
+    int minOrder = (int) parameters.getParameterRange("order").start;
+    int maxOrder = (int) parameters.getParameterRange("order").end;
+    int maxOverlaps = 1 << (int) parameters.getParameterRange("overlaps").end;
+    int maxBins = 0, maxFrames = 0, maxSize = 0;
+    for (int order = minOrder; order <= maxOrder; order++) {
+        int bins = (1 << order) / 2 + 1;
+        int frames = (int)(maxDelayTimeInSeconds * currentSampleRate / ((1 << order) / maxOverlaps) + 0.5f);
+        if (bins * frames > maxSize) {
+            maxBins = bins;
+            maxFrames = frames;
+            maxSize = bins * frames;
+        }
+    }
+    fftEngine.prepare(maxOrder, getTotalNumInputChannels() == 2);
+    pendingLatency = fftEngine.getLatencyInSamples();
+    setLatencySamples(pendingLatency);
+    for (auto channel = 0; channel < 2; channel++) {
+        delayLines[channel].prepare(maxBins, maxFrames);
+        resizeBuffers(channel);
+    }
 }
 
 void Plugex_32_spectralDelayAudioProcessor::releaseResources()
@@ -190,35 +216,18 @@ bool Plugex_32_spectralDelayAudioProcessor::isBusesLayoutSupported (const BusesL
 }
 #endif
 
-void Plugex_32_spectralDelayAudioProcessor::resizeBuffers(int order, int overlaps) {
-    int fftSize = 1 << order;
-    int hopsize = fftSize / overlaps;
-    currentNumberOfFrames = (int)(maxDelayTimeInSeconds * currentSampleRate / hopsize + 0.5f);
-    sampleBuffers[0].resize(currentNumberOfFrames * fftSize);
-    sampleBuffers[0].fill(0.0f);
-    sampleBuffers[1].resize(currentNumberOfFrames * fftSize);
-    sampleBuffers[1].fill(0.0f);
-    frameCount[0] = frameCount[1] = 0;
+void Plugex_32_spectralDelayAudioProcessor::resizeBuffers(int channel) {
+    int hopsize = fftEngine.getHopSize();
+    int numberOfFrames = (int)(maxDelayTimeInSeconds * currentSampleRate / hopsize + 0.5f);
+    delayLines[channel].setup(fftEngine.getSize() / 2 + 1, numberOfFrames);
 }
 
 void Plugex_32_spectralDelayAudioProcessor::computeFFTDelay() {
-    int filterSize = fftEngine[0].getSize() / 2 + 1;
-    for (int i = 0; i < filterSize; i++) {
-        float index = sinf(i / (float)filterSize * M_PI / 2.0f) * multiSliderNumberOfPoints;
-        int ipart = (int)index;
-        float fpart = index - ipart;
-        fftDelay[i] = delayPoints[ipart] + (delayPoints[ipart+1] - delayPoints[ipart]) * fpart;
-    }
+    fftDelay.setPoints(delayPoints);
 }
 
 void Plugex_32_spectralDelayAudioProcessor::computeFFTFeedback() {
-    int filterSize = fftEngine[0].getSize() / 2 + 1;
-    for (int i = 0; i < filterSize; i++) {
-        float index = sinf(i / (float)filterSize * M_PI / 2.0f) * multiSliderNumberOfPoints;
-        int ipart = (int)index;
-        float fpart = index - ipart;
-        fftFeedback[i] = feedbackPoints[ipart] + (feedbackPoints[ipart+1] - feedbackPoints[ipart]) * fpart;
-    }
+    fftFeedback.setPoints(feedbackPoints);
 }
 
 void Plugex_32_spectralDelayAudioProcessor::setDelayPoints(const Array<float> &value) {
@@ -239,31 +248,27 @@ void Plugex_32_spectralDelayAudioProcessor::setFeedbackPoints(const Array<float>
     computeFFTFeedback();
 }
 
-void Plugex_32_spectralDelayAudioProcessor::fftEngineFrameReady(FFTEngine *engine, float *fftData, int fftSize) {
-    int channel = (engine == &fftEngine[0]) ? 0 : 1;
-    int count = frameCount[channel];    
+void Plugex_32_spectralDelayAudioProcessor::fftEngineSplitFrameReady(FFTEngine *engine, int channel, float *real, float *imag, int fftSize) {
+    // Both channels of a frame share the curves picked up for the first one.
+    if (channel == 0) {
+        binDelays = fftDelay.getCurve(fftSize / 2 + 1);
+        binFeedbacks = fftFeedback.getCurve(fftSize / 2 + 1);
+    }
+    delayLines[channel].process(real, imag, binDelays, binFeedbacks);
+}
 
-    for (int j = 0; j < fftSize / 2 + 1; j++) {
-        int binDelay = (int)(fftDelay[j] * currentNumberOfFrames);
-        float binFeedback = fftFeedback[j];
-        binDelay = count - binDelay;
-        if (binDelay < 0) {
-            binDelay += currentNumberOfFrames;
-        }
-        if (binDelay < currentNumberOfFrames) {
-            int realIndex = j * 2;
-            int imagIndex = j * 2 + 1;
-            float realTemp = sampleBuffers[channel][binDelay * fftSize + realIndex];
-            float imagTemp = sampleBuffers[channel][binDelay * fftSize + imagIndex];
-            sampleBuffers[channel].set(count * fftSize + realIndex, fftData[realIndex] + realTemp * binFeedback);
-            sampleBuffers[channel].set(count * fftSize + imagIndex, fftData[imagIndex] + imagTemp * binFeedback);
-            fftData[realIndex] = realTemp;
-            fftData[imagIndex] = imagTemp;
-        }
+void Plugex_32_spectralDelayAudioProcessor::fftEngineSetupChanged(FFTEngine *engine) {
+    // Called on the audio thread, the timer reports the new latency.
+    pendingLatency = fftEngine.getLatencyInSamples();
+    for (auto channel = 0; channel < 2; channel++) {
+        resizeBuffers(channel);
     }
-    frameCount[channel]++;
-    if (frameCount[channel] >= currentNumberOfFrames)
-        frameCount[channel] = 0;
+}
+
+void Plugex_32_spectralDelayAudioProcessor::timerCallback() {
+    int latency = pendingLatency.load();
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
 }
 
 void Plugex_32_spectralDelayAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
@@ -280,21 +285,20 @@ void Plugex_32_spectralDelayAudioProcessor::processBlock (AudioBuffer<float>& bu
     int wintype = (int) *wintypeParameter;
 
     if (order != lastOrder || overlaps != lastOverlaps) {
-        resizeBuffers(order, overlaps);
-        computeFFTDelay();
-        computeFFTFeedback();
+        fftEngine.setup(order, overlaps, wintype);
     }
-    for (auto channel = 0; channel < totalNumInputChannels; channel++) {
-        if (order != lastOrder || overlaps != lastOverlaps) {
-            fftEngine[channel].setup(order, overlaps, wintype);
-        }
-        if (wintype != lastWintype) {
-            fftEngine[channel].setWintype(wintype);
-        }
-        auto *channelData = buffer.getWritePointer(channel);
-        for (int i = 0; i < buffer.getNumSamples(); i++) {
-            channelData[i] = fftEngine[channel].process(channelData[i]);
-        }
+    if (wintype != lastWintype) {
+        fftEngine.setWintype(wintype);
+    }
+
+    // A stereo-linked engine transforms both channels with a single complex FFT.
+    if (fftEngine.getNumChannels() == 2) {
+        auto *leftData = buffer.getWritePointer(0);
+        auto *rightData = buffer.getWritePointer(1);
+        fftEngine.processBlock(leftData, rightData, leftData, rightData, buffer.getNumSamples());
+    } else {
+        auto *channelData = buffer.getWritePointer(0);
+        fftEngine.processBlock(channelData, channelData, buffer.getNumSamples());
     }
     lastOrder = order;
     lastOverlaps = overlaps;
@@ -319,6 +323,7 @@ void Plugex_32_spectralDelayAudioProcessor::getStateInformation (MemoryBlock& de
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
     auto state = parameters.copyState();
+    state.setProperty(Identifier("stateVersion"), stateVersion, nullptr);
     std::unique_ptr<XmlElement> xml (state.createXml());
     copyXmlToBinary (*xml, destData);
 }
@@ -328,17 +333,22 @@ void Plugex_32_spectralDelayAudioProcessor::setStateInformation (const void* dat
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
+    int version = stateVersion;
     if (xmlState.get() != nullptr) {
         if (xmlState->hasTagName (parameters.state.getType())) {
             ValueTree state = ValueTree::fromXml (*xmlState);
+            // States saved before the version number had a 1 second maximum delay.
+            version = state.getProperty(Identifier("stateVersion"), 1);
             parameters.replaceState (state);
         }
     }
 
     ValueTree delayNode = parameters.state.getChildWithName(Identifier("delaySavedPoints"));
     if (delayNode.isValid()) {
+        float scale = version < 2 ? 1.0f / maxDelayTimeInSeconds : 1.0f;
         for (int i = 0; i < multiSliderNumberOfPoints; i++) {
-            delayPoints.set(i, (float) delayNode.getProperty(Identifier(String(i)), 0.0f));
+            delayPoints.set(i, (float) delayNode.getProperty(Identifier(String(i)), 0.0f) * scale);
+            delayNode.setProperty(Identifier(String(i)), delayPoints[i], nullptr);
         }
         computeFFTDelay();
         delayPointsChanged = true;
@@ -13,12 +13,17 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "FFTEngine.h"
+#include "SpectralDelayLine.h"
+#include "SpectralCurve.h"
 
 const int multiSliderNumberOfPoints = 350;
-const float maxDelayTimeInSeconds = 1.0f;
+const float maxDelayTimeInSeconds = 10.0f;
+// Version 2 stores the delay points as fractions of 10 seconds instead of 1.
+const int stateVersion = 2;
 
 class Plugex_32_spectralDelayAudioProcessor  : public AudioProcessor,
-                                             public FFTEngine::Listener
+                                             public FFTEngine::Listener,
+                                             public Timer
 {
 public:
     //==============================================================================
@@ -58,7 +63,10 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    void fftEngineFrameReady(FFTEngine *engine, float *fftData, int fftSize) override;
+    void fftEngineSplitFrameReady(FFTEngine *engine, int channel, float *real, float *imag, int fftSize) override;
+    void fftEngineSetupChanged(FFTEngine *engine) override;
+
+    void timerCallback() override;
 
     void computeFFTDelay();
     void computeFFTFeedback();
@@ -78,22 +86,25 @@ private:
 
     double currentSampleRate;
 
-    FFTEngine fftEngine[2];
-
-    float fftDelay[8193];
-    float fftFeedback[8193];
+    FFTEngine fftEngine;
 
-    void resizeBuffers(int order, int overlaps);
+    // Published by the message thread, read at each frame by the audio thread.
+    SpectralCurve fftDelay;
+    SpectralCurve fftFeedback;
+    const float *binDelays = nullptr;
+    const float *binFeedbacks = nullptr;
 
-    int frameCount[2];
-    int currentNumberOfFrames;
+    void resizeBuffers(int channel);
 
-    Array<float> sampleBuffers[2];
+    SpectralDelayLine delayLines[2];
 
     int lastOrder;
     int lastOverlaps;
     int lastWintype;
 
+    // Latency of the active FFT setup, reported to the host from the message thread.
+    std::atomic<int> pendingLatency { 0 };
+
     std::atomic<float> *orderParameter = nullptr;
     std::atomic<float> *overlapsParameter = nullptr;
     std::atomic<float> *wintypeParameter = nullptr;
@@ -35,6 +35,17 @@ Plugex_33_granularFreezeAudioProcessorEditor::Plugex_33_granularFreezeAudioProce
 
     activeAttachment.reset(new AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "active", activeButton));
 
+    envelopeLabel.setText("Envelope", NotificationType::dontSendNotification);
+    envelopeLabel.setJustificationType(Justification::centredRight);
+    addAndMakeVisible(&envelopeLabel);
+
+    envelopeCombo.setLookAndFeel(&plugexLookAndFeel);
+    envelopeCombo.addItemList({"Hanning", "Tukey", "Gaussian", "Trapezoid", "Expodec"}, 1);
+    envelopeCombo.setSelectedId(1);
+    addAndMakeVisible(&envelopeCombo);
+
+    envelopeAttachment.reset(new AudioProcessorValueTreeState::ComboBoxAttachment(valueTreeState, "envelope", envelopeCombo));
+
     densityLabel.setText("Density", NotificationType::dontSendNotification);
     densityLabel.setJustificationType(Justification::horizontallyCentred);
     addAndMakeVisible(&densityLabel);
@@ -83,6 +94,7 @@ Plugex_33_granularFreezeAudioProcessorEditor::Plugex_33_granularFreezeAudioProce
 Plugex_33_granularFreezeAudioProcessorEditor::~Plugex_33_granularFreezeAudioProcessorEditor()
 {
     activeButton.setLookAndFeel(nullptr);
+    envelopeCombo.setLookAndFeel(nullptr);
     densityKnob.setLookAndFeel(nullptr);
     pitchKnob.setLookAndFeel(nullptr);
     durationKnob.setLookAndFeel(nullptr);
@@ -105,7 +117,11 @@ void Plugex_33_granularFreezeAudioProcessorEditor::resized()
     title.setBounds(area.removeFromTop(36));
     area.removeFromTop(12);
 
-    activeButton.setBounds(area.removeFromTop(24));
+    auto activeArea = area.removeFromTop(24);
+    envelopeCombo.setBounds(activeArea.removeFromRight(110));
+    envelopeLabel.setBounds(activeArea.removeFromRight(80));
+    activeArea.removeFromRight(12);
+    activeButton.setBounds(activeArea);
     area.removeFromTop(12);
 
     auto area2 = area.removeFromTop(100);
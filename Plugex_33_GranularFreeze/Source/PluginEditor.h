@@ -42,6 +42,10 @@ private:
     TextButton activeButton;
     std::unique_ptr<AudioProcessorValueTreeState::ButtonAttachment> activeAttachment;
 
+    Label envelopeLabel;
+    ComboBox envelopeCombo;
+    std::unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> envelopeAttachment;
+
     Label  densityLabel;
     Slider densityKnob;
     std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> densityAttachment;
@@ -73,6 +73,10 @@ AudioProcessorValueTreeState::ParameterLayout createParameterLayout() {
                                                      NormalisableRange<float>(0.f, 100.0f, 0.001f, 0.3f),
                                                      5.0f, jitterSliderValueToText, jitterSliderTextToValue));
 
+    parameters.push_back(std::make_unique<Parameter>(String("envelope"), String("Envelope"), String(),
+                                                     NormalisableRange<float>(0.f, 4.f, 1.f, 1.0f),
+                                                     0.f, nullptr, nullptr));
+
     return { parameters.begin(), parameters.end() };
 }
 
@@ -91,6 +95,7 @@ Plugex_33_granularFreezeAudioProcessor::Plugex_33_granularFreezeAudioProcessor()
     parameters (*this, nullptr, Identifier(JucePlugin_Name), createParameterLayout())
 {
     activeParameter = parameters.getRawParameterValue("active");
+    envelopeParameter = parameters.getRawParameterValue("envelope");
     densityParameter = parameters.getRawParameterValue("density");
     pitchParameter = parameters.getRawParameterValue("pitch");
     durationParameter = parameters.getRawParameterValue("duration");
@@ -166,10 +171,9 @@ void Plugex_33_granularFreezeAudioProcessor::changeProgramName (int index, const
 //==============================================================================
 void Plugex_33_granularFreezeAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    granulator[0].setup(sampleRate, 0.5);
-    granulator[1].setup(sampleRate, 0.5);
-    granulator[0].setRecording(false);
-    granulator[1].setRecording(false);
+    granulator.setup(sampleRate, 0.5, getTotalNumInputChannels());
+    granulator.setRecording(false);
+    jitterRandom.reseed();
     portLastSample = *activeParameter;
     densitySmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     densitySmoothed.setCurrentAndTargetValue(*densityParameter);
@@ -225,34 +229,65 @@ void Plugex_33_granularFreezeAudioProcessor::processBlock (AudioBuffer<float>& b
     durationSmoothed.setTargetValue(*durationParameter);
     jitterSmoothed.setTargetValue(*jitterParameter);
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
+    bool active = (bool)*activeParameter;
+    if (active && !isActive)
+        granulator.setRecording(true);
+    isActive = active;
+    granulator.setEnvelope((int)*envelopeParameter);
+
+    const int numChannels = jmin((int)totalNumInputChannels, (int)Granulator::maxChannels);
+    float density[Granulator::maxBlockSize], pitch[Granulator::maxBlockSize], duration[Granulator::maxBlockSize];
+    float position[Granulator::maxBlockSize], deviation[Granulator::maxBlockSize];
+    float freezeSamples[Granulator::maxChannels][Granulator::maxBlockSize];
+
+    for (int start = 0; start < buffer.getNumSamples(); start += Granulator::maxBlockSize)
     {
-        float jitter = jitterSmoothed.getNextValue() * 0.01f;
-        float density = densitySmoothed.getNextValue() + jitterRandom.nextFloat() * 10.f * jitter;
-        float pitch = pitchSmoothed.getNextValue() * ((jitterRandom.nextFloat() - 0.5f) * 0.25f * jitter + 1.f);
-        float duration = durationSmoothed.getNextValue() * ((jitterRandom.nextFloat() - 0.5f) * 0.25f * jitter + 1.f);
-        float position = jitterRandom.nextFloat() * 0.8f * jitter;
-        float deviation = jitterRandom.nextFloat() * 0.2f * jitter;
-        
-        bool activateRecording = (bool)*activeParameter && !isActive;
-        portLastSample = *activeParameter + (portLastSample - *activeParameter) * 0.9999;
+        int blockSize = jmin((int)Granulator::maxBlockSize, buffer.getNumSamples() - start);
+
+        for (int i = 0; i < blockSize; i++)
+        {
+            float jitter = jitterSmoothed.getNextValue() * 0.01f;
+            density[i] = densitySmoothed.getNextValue() + jitterRandom.nextFloat() * 10.f * jitter;
+            pitch[i] = pitchSmoothed.getNextValue() * ((jitterRandom.nextFloat() - 0.5f) * 0.25f * jitter + 1.f);
+            duration[i] = durationSmoothed.getNextValue() * ((jitterRandom.nextFloat() - 0.5f) * 0.25f * jitter + 1.f);
+            position[i] = jitterRandom.nextFloat() * 0.8f * jitter;
+            deviation[i] = jitterRandom.nextFloat() * 0.2f * jitter;
+        }
+
+        const float *inputs[Granulator::maxChannels];
+        float *outputs[Granulator::maxChannels];
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            inputs[channel] = buffer.getReadPointer (channel, start);
+            outputs[channel] = freezeSamples[channel];
+        }
+
+        if (isActive)
+        {
+            Granulator::BlockParameters blockParameters;
+            blockParameters.density = density;
+            blockParameters.pitch = pitch;
+            blockParameters.duration = duration;
+            blockParameters.position = position;
+            blockParameters.deviation = deviation;
+            granulator.processBlock(inputs, outputs, blockSize, blockParameters);
+        }
+        else
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                FloatVectorOperations::clear(freezeSamples[channel], blockSize);
+        }
 
-        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+        float portTarget = active ? 1.f : 0.f;
+        for (int i = 0; i < blockSize; i++)
         {
-            float freezeSample = 0.f;
-            auto* channelData = buffer.getWritePointer (channel);
-            if (activateRecording)
-                granulator[channel].setRecording(true);
-            granulator[channel].setDensity(density);
-            granulator[channel].setPitch(pitch);
-            granulator[channel].setDuration(duration);
-            granulator[channel].setPosition(position);
-            granulator[channel].setDeviation(deviation);
-            if (isActive)
-                freezeSample = granulator[channel].process(channelData[i]);
-            channelData[i] = channelData[i] + (freezeSample - channelData[i]) * portLastSample;
+            portLastSample = portTarget + (portLastSample - portTarget) * 0.9999;
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* channelData = buffer.getWritePointer (channel, start);
+                channelData[i] = channelData[i] + (freezeSamples[channel][i] - channelData[i]) * portLastSample;
+            }
         }
-        isActive = (bool)*activeParameter;
     }
 }
 
@@ -13,6 +13,7 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 
+#include "FastRandom.h"
 #include "Granulator.h"
 
 //==============================================================================
@@ -62,15 +63,18 @@ private:
     //==============================================================================
     AudioProcessorValueTreeState parameters;
 
-    Random jitterRandom;
+    FastRandom jitterRandom;
 
-    Granulator granulator[2];
+    // A single stereo granulator, both channels share the same grains.
+    Granulator granulator;
 
     float portLastSample = 0.f;
 
     bool isActive = false;
     std::atomic<float> *activeParameter = nullptr;
 
+    std::atomic<float> *envelopeParameter = nullptr;
+
     std::atomic<float> *densityParameter = nullptr;
     SmoothedValue<float> densitySmoothed;
 
@@ -18,7 +18,7 @@ Plugex_34_granularStretcherAudioProcessorEditor::Plugex_34_granularStretcherAudi
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 220);
+    setSize (400, 292);
 
     setLookAndFeel(&plugexLookAndFeel);
     plugexLookAndFeel.setTheme("lightblue");
@@ -35,6 +35,41 @@ Plugex_34_granularStretcherAudioProcessorEditor::Plugex_34_granularStretcherAudi
 
     activeAttachment.reset(new AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "active", activeButton));
 
+    loadButton.setLookAndFeel(&plugexLookAndFeel);
+    loadButton.setButtonText("Load file...");
+    loadButton.addListener(this);
+    addAndMakeVisible(&loadButton);
+
+    liveButton.setLookAndFeel(&plugexLookAndFeel);
+    liveButton.setButtonText("Live input");
+    liveButton.addListener(this);
+    addAndMakeVisible(&liveButton);
+
+    addAndMakeVisible(&sourceLabel);
+    updateSourceLabel();
+
+    envelopeLabel.setText("Envelope", NotificationType::dontSendNotification);
+    envelopeLabel.setJustificationType(Justification::centredRight);
+    addAndMakeVisible(&envelopeLabel);
+
+    envelopeCombo.setLookAndFeel(&plugexLookAndFeel);
+    envelopeCombo.addItemList({"Hanning", "Tukey", "Gaussian", "Trapezoid", "Expodec"}, 1);
+    envelopeCombo.setSelectedId(1);
+    addAndMakeVisible(&envelopeCombo);
+
+    envelopeAttachment.reset(new AudioProcessorValueTreeState::ComboBoxAttachment(valueTreeState, "envelope", envelopeCombo));
+
+    storageLabel.setText("Storage", NotificationType::dontSendNotification);
+    storageLabel.setJustificationType(Justification::centredRight);
+    addAndMakeVisible(&storageLabel);
+
+    storageCombo.setLookAndFeel(&plugexLookAndFeel);
+    storageCombo.addItemList({"Float", "16 bits", "24 bits"}, 1);
+    storageCombo.setSelectedId(1);
+    addAndMakeVisible(&storageCombo);
+
+    storageAttachment.reset(new AudioProcessorValueTreeState::ComboBoxAttachment(valueTreeState, "storage", storageCombo));
+
     durationLabel.setText("Duration", NotificationType::dontSendNotification);
     durationLabel.setJustificationType(Justification::horizontallyCentred);
     addAndMakeVisible(&durationLabel);
@@ -83,6 +118,10 @@ Plugex_34_granularStretcherAudioProcessorEditor::Plugex_34_granularStretcherAudi
 Plugex_34_granularStretcherAudioProcessorEditor::~Plugex_34_granularStretcherAudioProcessorEditor()
 {
     activeButton.setLookAndFeel(nullptr);
+    loadButton.setLookAndFeel(nullptr);
+    liveButton.setLookAndFeel(nullptr);
+    envelopeCombo.setLookAndFeel(nullptr);
+    storageCombo.setLookAndFeel(nullptr);
     durationKnob.setLookAndFeel(nullptr);
     pitchKnob.setLookAndFeel(nullptr);
     speedKnob.setLookAndFeel(nullptr);
@@ -105,7 +144,24 @@ void Plugex_34_granularStretcherAudioProcessorEditor::resized()
     title.setBounds(area.removeFromTop(36));
     area.removeFromTop(12);
 
-    activeButton.setBounds(area.removeFromTop(24));
+    auto activeArea = area.removeFromTop(24);
+    envelopeCombo.setBounds(activeArea.removeFromRight(110));
+    envelopeLabel.setBounds(activeArea.removeFromRight(80));
+    activeArea.removeFromRight(12);
+    activeButton.setBounds(activeArea);
+    area.removeFromTop(12);
+
+    auto sourceArea = area.removeFromTop(24);
+    loadButton.setBounds(sourceArea.removeFromLeft(110));
+    sourceArea.removeFromLeft(12);
+    liveButton.setBounds(sourceArea.removeFromLeft(110));
+    sourceArea.removeFromLeft(12);
+    sourceLabel.setBounds(sourceArea);
+    area.removeFromTop(12);
+
+    auto storageArea = area.removeFromTop(24);
+    storageCombo.setBounds(storageArea.removeFromRight(110));
+    storageLabel.setBounds(storageArea.removeFromRight(80));
     area.removeFromTop(12);
 
     auto area2 = area.removeFromTop(100);
@@ -128,3 +184,30 @@ void Plugex_34_granularStretcherAudioProcessorEditor::resized()
 
     area.removeFromTop(12);
 }
+
+void Plugex_34_granularStretcherAudioProcessorEditor::buttonClicked (Button* button)
+{
+    if (button == &liveButton)
+    {
+        processor.loadSourceFile(File());
+        updateSourceLabel();
+    }
+    else if (button == &loadButton)
+    {
+        // Asynchronous, plugins can't run modal loops.
+        fileChooser.reset(new FileChooser("Sound file to granulate", processor.getSourceFile(), "*.wav;*.aif;*.aiff;*.flac;*.ogg"));
+        fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles,
+                                 [this] (const FileChooser& chooser)
+                                 {
+                                     File file = chooser.getResult();
+                                     if (file.existsAsFile() && processor.loadSourceFile(file))
+                                         updateSourceLabel();
+                                 });
+    }
+}
+
+void Plugex_34_granularStretcherAudioProcessorEditor::updateSourceLabel()
+{
+    File file = processor.getSourceFile();
+    sourceLabel.setText(file == File() ? "Granulating the input" : file.getFileName(), NotificationType::dontSendNotification);
+}
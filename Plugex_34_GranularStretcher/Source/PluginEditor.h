@@ -18,7 +18,8 @@
 //==============================================================================
 /**
 */
-class Plugex_34_granularStretcherAudioProcessorEditor  : public AudioProcessorEditor
+class Plugex_34_granularStretcherAudioProcessorEditor  : public AudioProcessorEditor,
+                                                        public Button::Listener
 {
 public:
     Plugex_34_granularStretcherAudioProcessorEditor (Plugex_34_granularStretcherAudioProcessor&, AudioProcessorValueTreeState& vts);
@@ -28,6 +29,8 @@ public:
     void paint (Graphics&) override;
     void resized() override;
 
+    void buttonClicked (Button* button) override;
+
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -42,6 +45,21 @@ private:
     TextButton activeButton;
     std::unique_ptr<AudioProcessorValueTreeState::ButtonAttachment> activeAttachment;
 
+    TextButton loadButton;
+    TextButton liveButton;
+    Label sourceLabel;
+    std::unique_ptr<FileChooser> fileChooser;
+
+    void updateSourceLabel();
+
+    Label envelopeLabel;
+    ComboBox envelopeCombo;
+    std::unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> envelopeAttachment;
+
+    Label storageLabel;
+    ComboBox storageCombo;
+    std::unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> storageAttachment;
+
     Label  durationLabel;
     Slider durationKnob;
     std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> durationAttachment;
@@ -73,6 +73,14 @@ AudioProcessorValueTreeState::ParameterLayout createParameterLayout() {
                                                      NormalisableRange<float>(0.f, 100.0f, 0.001f, 0.3f),
                                                      5.0f, jitterSliderValueToText, jitterSliderTextToValue));
 
+    parameters.push_back(std::make_unique<Parameter>(String("envelope"), String("Envelope"), String(),
+                                                     NormalisableRange<float>(0.f, 4.f, 1.f, 1.0f),
+                                                     0.f, nullptr, nullptr));
+
+    parameters.push_back(std::make_unique<Parameter>(String("storage"), String("Storage"), String(),
+                                                     NormalisableRange<float>(0.f, 2.f, 1.f, 1.0f),
+                                                     0.f, nullptr, nullptr));
+
     return { parameters.begin(), parameters.end() };
 }
 
@@ -91,10 +99,14 @@ Plugex_34_granularStretcherAudioProcessor::Plugex_34_granularStretcherAudioProce
     parameters (*this, nullptr, Identifier(JucePlugin_Name), createParameterLayout())
 {
     activeParameter = parameters.getRawParameterValue("active");
+    envelopeParameter = parameters.getRawParameterValue("envelope");
+    storageParameter = parameters.getRawParameterValue("storage");
     durationParameter = parameters.getRawParameterValue("duration");
     pitchParameter = parameters.getRawParameterValue("pitch");
     speedParameter = parameters.getRawParameterValue("speed");
     jitterParameter = parameters.getRawParameterValue("jitter");
+
+    startTimer(100);
 }
 
 Plugex_34_granularStretcherAudioProcessor::~Plugex_34_granularStretcherAudioProcessor()
@@ -167,10 +179,11 @@ void Plugex_34_granularStretcherAudioProcessor::changeProgramName (int index, co
 void Plugex_34_granularStretcherAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     m_sampleRate = sampleRate;
-    granulator[0].setup(sampleRate, 10.f);
-    granulator[1].setup(sampleRate, 10.f);
-    granulator[0].setRecording(false);
-    granulator[1].setRecording(false);
+    // 10 seconds of recording, as floats or as 16/24-bit blocks to save memory.
+    storageFormat = (int)*storageParameter;
+    granulator.setup(sampleRate, 10.f, getTotalNumInputChannels(), storageFormat);
+    granulator.setRecording(false);
+    jitterRandom.reseed();
     portLastSample = *activeParameter;
     durationSmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     durationSmoothed.setCurrentAndTargetValue(*durationParameter);
@@ -212,6 +225,23 @@ bool Plugex_34_granularStretcherAudioProcessor::isBusesLayoutSupported (const Bu
 }
 #endif
 
+void Plugex_34_granularStretcherAudioProcessor::timerCallback()
+{
+    // Before prepareToPlay, the new format is simply picked up there.
+    int format = (int)*storageParameter;
+    if (format == storageFormat || getSampleRate() <= 0.0)
+        return;
+
+    // The recording is reallocated, and started again, between two blocks.
+    bool wasSuspended = isSuspended();
+    suspendProcessing(true);
+    storageFormat = format;
+    granulator.setup(m_sampleRate, 10.f, getTotalNumInputChannels(), storageFormat);
+    granulator.setRecording(false);
+    isActive = false;
+    suspendProcessing(wasSuspended);
+}
+
 void Plugex_34_granularStretcherAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
     ScopedNoDenormals noDenormals;
@@ -226,53 +256,104 @@ void Plugex_34_granularStretcherAudioProcessor::processBlock (AudioBuffer<float>
     speedSmoothed.setTargetValue(*speedParameter);
     jitterSmoothed.setTargetValue(*jitterParameter);
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
     {
-        float jitter = jitterSmoothed.getNextValue() * 0.01f;
-        float duration = durationSmoothed.getNextValue();
-        float grainDuration = 0.15 * ((jitterRandom.nextFloat() - 0.5f) * 0.05f * jitter + 1.f);
-        float pitch = pitchSmoothed.getNextValue() * ((jitterRandom.nextFloat() - 0.5f) * 0.05f * jitter + 1.f);
-        float deviation = jitterRandom.nextFloat() * 0.05f * jitter;
-        float density = 100.f + jitterRandom.nextFloat() * 5.f * jitter;
-
-        float speed = speedSmoothed.getNextValue() * ((jitterRandom.nextFloat() - 0.5f) * 0.05f * jitter + 1.f);
-        float position = readerIndex * ((jitterRandom.nextFloat() - 0.5f) * 0.05f * jitter + 1.f);
-        readerIndex += readerBaseInc * speed;
-        if (readerIndex >= 1.f)
-            readerIndex -= 1.f;
-
-        bool activateRecording = (bool)*activeParameter && !isActive;
-        if (activateRecording)
-            readerBaseInc = (1.f / duration) / m_sampleRate;
-
-        if (!isActive || granulator[0].getIsRecording()) {
-            portLastSample = 0.f + (portLastSample - 0.f) * 0.9999;
-        } else {
-            portLastSample = 1.f + (portLastSample - 1.f) * 0.9999;
+        // A new source, or the input again, is picked up between two blocks.
+        const SpinLock::ScopedTryLockType lock (sourceLock);
+        if (lock.isLocked() && sourceChangePending && retiredSource == nullptr)
+        {
+            retiredSource = std::move (currentSource);
+            currentSource = std::move (pendingSource);
+            sourceChangePending = false;
+            granulator.setSource (currentSource.get());
+            readerIndex = 0.f;
         }
+    }
 
-        if (isRecording && !granulator[0].getIsRecording())
-            readerIndex = 0.f;
+    bool active = (bool)*activeParameter;
+    if (active && !isActive)
+    {
+        float duration = durationSmoothed.getCurrentValue();
+        readerBaseInc = (1.f / duration) / m_sampleRate;
+        granulator.setRecordingSize(duration);
+        granulator.setRecording(true);
+    }
+    isActive = active;
+
+    // A file is read from start to end, in the time given by its length.
+    if (currentSource != nullptr)
+        readerBaseInc = (1.f / (currentSource->getLength() / currentSource->getSampleRate())) / m_sampleRate;
+
+    granulator.setEnvelope((int)*envelopeParameter);
+
+    const int numChannels = jmin((int)totalNumInputChannels, (int)Granulator::maxChannels);
+    float density[Granulator::maxBlockSize], pitch[Granulator::maxBlockSize], grainDuration[Granulator::maxBlockSize];
+    float position[Granulator::maxBlockSize], deviation[Granulator::maxBlockSize];
+    float stretchSamples[Granulator::maxChannels][Granulator::maxBlockSize];
 
-        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+    int start = 0;
+    while (start < buffer.getNumSamples())
+    {
+        // Sub-blocks stop where the recording ends, so the reader
+        // restarts at the beginning of the new sound right after it.
+        int blockSize = jmin((int)Granulator::maxBlockSize, buffer.getNumSamples() - start);
+        if (isActive && granulator.getIsRecording())
+            blockSize = (int)jmin((long)blockSize, granulator.getRemainingRecordingSamples());
+
+        for (int i = 0; i < blockSize; i++)
         {
-            float stretchSample = 0.f;
-            auto* channelData = buffer.getWritePointer (channel);
-            if (activateRecording) {
-                granulator[channel].setRecordingSize(duration);
-                granulator[channel].setRecording(true);
+            float jitter = jitterSmoothed.getNextValue() * 0.01f;
+            durationSmoothed.getNextValue();
+            grainDuration[i] = 0.15 * ((jitterRandom.nextFloat() - 0.5f) * 0.05f * jitter + 1.f);
+            pitch[i] = pitchSmoothed.getNextValue() * ((jitterRandom.nextFloat() - 0.5f) * 0.05f * jitter + 1.f);
+            deviation[i] = jitterRandom.nextFloat() * 0.05f * jitter;
+            density[i] = 100.f + jitterRandom.nextFloat() * 5.f * jitter;
+
+            float speed = speedSmoothed.getNextValue() * ((jitterRandom.nextFloat() - 0.5f) * 0.05f * jitter + 1.f);
+            position[i] = readerIndex * ((jitterRandom.nextFloat() - 0.5f) * 0.05f * jitter + 1.f);
+            readerIndex += readerBaseInc * speed;
+            if (readerIndex >= 1.f)
+                readerIndex -= 1.f;
+        }
+
+        const float *inputs[Granulator::maxChannels];
+        float *outputs[Granulator::maxChannels];
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            inputs[channel] = buffer.getReadPointer (channel, start);
+            outputs[channel] = stretchSamples[channel];
+        }
+
+        float portTarget = (!isActive || granulator.getIsRecording()) ? 0.f : 1.f;
+        if (isActive)
+        {
+            Granulator::BlockParameters blockParameters;
+            blockParameters.density = density;
+            blockParameters.pitch = pitch;
+            blockParameters.duration = grainDuration;
+            blockParameters.position = position;
+            blockParameters.deviation = deviation;
+            granulator.processBlock(inputs, outputs, blockSize, blockParameters);
+        }
+        else
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                FloatVectorOperations::clear(stretchSamples[channel], blockSize);
+        }
+
+        for (int i = 0; i < blockSize; i++)
+        {
+            portLastSample = portTarget + (portLastSample - portTarget) * 0.9999;
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* channelData = buffer.getWritePointer (channel, start);
+                channelData[i] = channelData[i] + (stretchSamples[channel][i] - channelData[i]) * portLastSample;
             }
-            granulator[channel].setDensity(density);
-            granulator[channel].setPitch(pitch);
-            granulator[channel].setDuration(grainDuration);
-            granulator[channel].setPosition(position);
-            granulator[channel].setDeviation(deviation);
-            if (isActive)
-                stretchSample = granulator[channel].process(channelData[i]);
-            channelData[i] = channelData[i] + (stretchSample - channelData[i]) * portLastSample;
         }
-        isActive = (bool)*activeParameter;
-        isRecording = granulator[0].getIsRecording();
+
+        if (isRecording && !granulator.getIsRecording())
+            readerIndex = 0.f;
+        isRecording = granulator.getIsRecording();
+        start += blockSize;
     }
 }
 
@@ -301,6 +382,35 @@ void Plugex_34_granularStretcherAudioProcessor::setStateInformation (const void*
     // whose contents will have been created by the getStateInformation() call.
 }
 
+//==============================================================================
+bool Plugex_34_granularStretcherAudioProcessor::loadSourceFile (const File& file)
+{
+    std::unique_ptr<GranularFileSource> newSource;
+    if (file != File())
+    {
+        newSource.reset (new GranularFileSource());
+        if (! newSource->open (file))
+            return false;
+    }
+
+    // Released after the lock, the audio thread only tries to take it.
+    std::unique_ptr<GranularFileSource> unused[2];
+    {
+        const SpinLock::ScopedLockType lock (sourceLock);
+        unused[0] = std::move (retiredSource);
+        unused[1] = std::move (pendingSource);
+        pendingSource = std::move (newSource);
+        sourceChangePending = true;
+    }
+    sourceFile = file;
+    return true;
+}
+
+File Plugex_34_granularStretcherAudioProcessor::getSourceFile() const
+{
+    return sourceFile;
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
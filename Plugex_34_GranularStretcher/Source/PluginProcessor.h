@@ -13,12 +13,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 
+#include "FastRandom.h"
 #include "Granulator.h"
+#include "GranularFileSource.h"
 
 //==============================================================================
 /**
 */
-class Plugex_34_granularStretcherAudioProcessor  : public AudioProcessor
+class Plugex_34_granularStretcherAudioProcessor  : public AudioProcessor,
+                                                  public Timer
 {
 public:
     //==============================================================================
@@ -58,15 +61,35 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    //==============================================================================
+    /** Granulates the file instead of the input, or the input again with
+        File(). Called from the message thread, returns false if the file
+        can't be read. */
+    bool loadSourceFile (const File& file);
+    File getSourceFile() const;
+
+    void timerCallback() override;
+
 private:
     //==============================================================================
     AudioProcessorValueTreeState parameters;
 
     double m_sampleRate;
 
-    Random jitterRandom;
+    FastRandom jitterRandom;
 
-    Granulator granulator[2];
+    // A single stereo granulator, both channels share the same grains.
+    Granulator granulator;
+
+    // Files are opened on the message thread and handed over in
+    // pendingSource. The audio thread picks them up and leaves the previous
+    // source in retiredSource, deleted on the message thread by the next load.
+    SpinLock sourceLock;
+    std::unique_ptr<GranularFileSource> pendingSource;
+    std::unique_ptr<GranularFileSource> currentSource;
+    std::unique_ptr<GranularFileSource> retiredSource;
+    bool sourceChangePending = false;
+    File sourceFile;
 
     float portLastSample = 0.f;
     float readerIndex = 0.f;
@@ -77,6 +100,13 @@ private:
     bool isActive = false;
     std::atomic<float> *activeParameter = nullptr;
 
+    std::atomic<float> *envelopeParameter = nullptr;
+
+    // Storage format of the recording, a change reallocates it from the
+    // message thread while the processing is suspended.
+    std::atomic<float> *storageParameter = nullptr;
+    int storageFormat = Granulator::storeFloat32;
+
     std::atomic<float> *durationParameter = nullptr;
     SmoothedValue<float> durationSmoothed;
 
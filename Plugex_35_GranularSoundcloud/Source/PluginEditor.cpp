@@ -18,7 +18,7 @@ Plugex_35_granularSoundcloudAudioProcessorEditor::Plugex_35_granularSoundcloudAu
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 220);
+    setSize (400, 256);
 
     setLookAndFeel(&plugexLookAndFeel);
     plugexLookAndFeel.setTheme("lightblue");
@@ -35,6 +35,30 @@ Plugex_35_granularSoundcloudAudioProcessorEditor::Plugex_35_granularSoundcloudAu
 
     activeAttachment.reset(new AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "active", activeButton));
 
+    loadButton.setLookAndFeel(&plugexLookAndFeel);
+    loadButton.setButtonText("Load file...");
+    loadButton.addListener(this);
+    addAndMakeVisible(&loadButton);
+
+    liveButton.setLookAndFeel(&plugexLookAndFeel);
+    liveButton.setButtonText("Live input");
+    liveButton.addListener(this);
+    addAndMakeVisible(&liveButton);
+
+    addAndMakeVisible(&sourceLabel);
+    updateSourceLabel();
+
+    envelopeLabel.setText("Envelope", NotificationType::dontSendNotification);
+    envelopeLabel.setJustificationType(Justification::centredRight);
+    addAndMakeVisible(&envelopeLabel);
+
+    envelopeCombo.setLookAndFeel(&plugexLookAndFeel);
+    envelopeCombo.addItemList({"Hanning", "Tukey", "Gaussian", "Trapezoid", "Expodec"}, 1);
+    envelopeCombo.setSelectedId(1);
+    addAndMakeVisible(&envelopeCombo);
+
+    envelopeAttachment.reset(new AudioProcessorValueTreeState::ComboBoxAttachment(valueTreeState, "envelope", envelopeCombo));
+
     densityLabel.setText("Density", NotificationType::dontSendNotification);
     densityLabel.setJustificationType(Justification::horizontallyCentred);
     addAndMakeVisible(&densityLabel);
@@ -83,6 +107,9 @@ Plugex_35_granularSoundcloudAudioProcessorEditor::Plugex_35_granularSoundcloudAu
 Plugex_35_granularSoundcloudAudioProcessorEditor::~Plugex_35_granularSoundcloudAudioProcessorEditor()
 {
     activeButton.setLookAndFeel(nullptr);
+    loadButton.setLookAndFeel(nullptr);
+    liveButton.setLookAndFeel(nullptr);
+    envelopeCombo.setLookAndFeel(nullptr);
     densityKnob.setLookAndFeel(nullptr);
     rndpitKnob.setLookAndFeel(nullptr);
     rndposKnob.setLookAndFeel(nullptr);
@@ -105,7 +132,19 @@ void Plugex_35_granularSoundcloudAudioProcessorEditor::resized()
     title.setBounds(area.removeFromTop(36));
     area.removeFromTop(12);
 
-    activeButton.setBounds(area.removeFromTop(24));
+    auto activeArea = area.removeFromTop(24);
+    envelopeCombo.setBounds(activeArea.removeFromRight(110));
+    envelopeLabel.setBounds(activeArea.removeFromRight(80));
+    activeArea.removeFromRight(12);
+    activeButton.setBounds(activeArea);
+    area.removeFromTop(12);
+
+    auto sourceArea = area.removeFromTop(24);
+    loadButton.setBounds(sourceArea.removeFromLeft(110));
+    sourceArea.removeFromLeft(12);
+    liveButton.setBounds(sourceArea.removeFromLeft(110));
+    sourceArea.removeFromLeft(12);
+    sourceLabel.setBounds(sourceArea);
     area.removeFromTop(12);
 
     auto area2 = area.removeFromTop(100);
@@ -128,3 +167,30 @@ void Plugex_35_granularSoundcloudAudioProcessorEditor::resized()
 
     area.removeFromTop(12);
 }
+
+void Plugex_35_granularSoundcloudAudioProcessorEditor::buttonClicked (Button* button)
+{
+    if (button == &liveButton)
+    {
+        processor.loadSourceFile(File());
+        updateSourceLabel();
+    }
+    else if (button == &loadButton)
+    {
+        // Asynchronous, plugins can't run modal loops.
+        fileChooser.reset(new FileChooser("Sound file to granulate", processor.getSourceFile(), "*.wav;*.aif;*.aiff;*.flac;*.ogg"));
+        fileChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles,
+                                 [this] (const FileChooser& chooser)
+                                 {
+                                     File file = chooser.getResult();
+                                     if (file.existsAsFile() && processor.loadSourceFile(file))
+                                         updateSourceLabel();
+                                 });
+    }
+}
+
+void Plugex_35_granularSoundcloudAudioProcessorEditor::updateSourceLabel()
+{
+    File file = processor.getSourceFile();
+    sourceLabel.setText(file == File() ? "Granulating the input" : file.getFileName(), NotificationType::dontSendNotification);
+}
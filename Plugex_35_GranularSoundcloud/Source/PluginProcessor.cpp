@@ -57,6 +57,10 @@ AudioProcessorValueTreeState::ParameterLayout createParameterLayout() {
                                                      NormalisableRange<float>(0.f, 100.f, 0.01f, 1.f),
                                                      50.f, sliderValueToText, sliderTextToValue));
 
+    parameters.push_back(std::make_unique<Parameter>(String("envelope"), String("Envelope"), String(),
+                                                     NormalisableRange<float>(0.f, 4.f, 1.f, 1.0f),
+                                                     0.f, nullptr, nullptr));
+
     return { parameters.begin(), parameters.end() };
 }
 
@@ -75,6 +79,7 @@ Plugex_35_granularSoundcloudAudioProcessor::Plugex_35_granularSoundcloudAudioPro
     parameters (*this, nullptr, Identifier(JucePlugin_Name), createParameterLayout())
 {
     activeParameter = parameters.getRawParameterValue("active");
+    envelopeParameter = parameters.getRawParameterValue("envelope");
     densityParameter = parameters.getRawParameterValue("density");
     rndpitParameter = parameters.getRawParameterValue("rndpit");
     rndposParameter = parameters.getRawParameterValue("rndpos");
@@ -151,10 +156,13 @@ void Plugex_35_granularSoundcloudAudioProcessor::changeProgramName (int index, c
 void Plugex_35_granularSoundcloudAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     m_sampleRate = sampleRate;
-    granulator[0].setup(sampleRate, 2.f);
-    granulator[1].setup(sampleRate, 2.f);
-    granulator[0].setRecording(false);
-    granulator[1].setRecording(false);
+    granulator.setup(sampleRate, 2.f, getTotalNumInputChannels());
+    // Offline renders spread the grains of dense clouds over the cores. The
+    // threads are started here and only used while processBlock() finds the
+    // host rendering offline, which can change without a new prepareToPlay().
+    granulator.setRenderThreads(jmin(4, SystemStats::getNumCpus()));
+    granulator.setRecording(false);
+    jitterRandom.reseed();
     portLastSample = *activeParameter;
     densitySmoothed.reset(sampleRate, samplesPerBlock/sampleRate);
     densitySmoothed.setCurrentAndTargetValue(*densityParameter);
@@ -205,46 +213,91 @@ void Plugex_35_granularSoundcloudAudioProcessor::processBlock (AudioBuffer<float
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
+    granulator.setRenderThreadsEnabled(isNonRealtime());
+
     densitySmoothed.setTargetValue(*densityParameter);
     rndpitSmoothed.setTargetValue(*rndpitParameter);
     rndposSmoothed.setTargetValue(*rndposParameter);
     rnddurSmoothed.setTargetValue(*rnddurParameter);
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
     {
-        float rndpit = rndpitSmoothed.getNextValue() * 0.019f;
-        float rndpos = rndposSmoothed.getNextValue() * 0.019f;
-        float rnddur = rnddurSmoothed.getNextValue() * 0.019f;
+        // A new source, or the input again, is picked up between two blocks.
+        const SpinLock::ScopedTryLockType lock (sourceLock);
+        if (lock.isLocked() && sourceChangePending && retiredSource == nullptr)
+        {
+            retiredSource = std::move (currentSource);
+            currentSource = std::move (pendingSource);
+            sourceChangePending = false;
+            granulator.setSource (currentSource.get());
+        }
+    }
+
+    bool active = (bool)*activeParameter;
+    if (active && !isActive)
+        granulator.setRecording(true);
+    isActive = active;
+    granulator.setEnvelope((int)*envelopeParameter);
 
-        float density = densitySmoothed.getNextValue();
-        float pitch = 1.f * (jitterRandom.nextFloat() * rndpit - (rndpit * 0.5f) + 1.f);
-        float position = 0.5f * (jitterRandom.nextFloat() * rndpos - (rndpos * 0.5f) + 1.f);
-        float duration = 0.2f * (jitterRandom.nextFloat() * rnddur - (rnddur * 0.5f) + 1.f);
+    const int numChannels = jmin((int)totalNumInputChannels, (int)Granulator::maxChannels);
+    float density[Granulator::maxBlockSize], pitch[Granulator::maxBlockSize];
+    float position[Granulator::maxBlockSize], duration[Granulator::maxBlockSize];
+    float cloudSamples[Granulator::maxChannels][Granulator::maxBlockSize];
 
-        bool activateRecording = (bool)*activeParameter && !isActive;
+    int start = 0;
+    while (start < buffer.getNumSamples())
+    {
+        // Sub-blocks stop where the recording ends, so the fade in
+        // starts on the first sample of the cloud.
+        int blockSize = jmin((int)Granulator::maxBlockSize, buffer.getNumSamples() - start);
+        if (isActive && granulator.getIsRecording())
+            blockSize = (int)jmin((long)blockSize, granulator.getRemainingRecordingSamples());
+
+        for (int i = 0; i < blockSize; i++)
+        {
+            float rndpit = rndpitSmoothed.getNextValue() * 0.019f;
+            float rndpos = rndposSmoothed.getNextValue() * 0.019f;
+            float rnddur = rnddurSmoothed.getNextValue() * 0.019f;
+
+            density[i] = densitySmoothed.getNextValue();
+            pitch[i] = 1.f * (jitterRandom.nextFloat() * rndpit - (rndpit * 0.5f) + 1.f);
+            position[i] = 0.5f * (jitterRandom.nextFloat() * rndpos - (rndpos * 0.5f) + 1.f);
+            duration[i] = 0.2f * (jitterRandom.nextFloat() * rnddur - (rnddur * 0.5f) + 1.f);
+        }
+
+        const float *inputs[Granulator::maxChannels];
+        float *outputs[Granulator::maxChannels];
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            inputs[channel] = buffer.getReadPointer (channel, start);
+            outputs[channel] = cloudSamples[channel];
+        }
 
-        if (!isActive || granulator[0].getIsRecording()) {
-            portLastSample = 0.f + (portLastSample - 0.f) * 0.9999;
-        } else {
-            portLastSample = 1.f + (portLastSample - 1.f) * 0.9999;
+        float portTarget = (!isActive || granulator.getIsRecording()) ? 0.f : 1.f;
+        if (isActive)
+        {
+            Granulator::BlockParameters blockParameters;
+            blockParameters.density = density;
+            blockParameters.pitch = pitch;
+            blockParameters.duration = duration;
+            blockParameters.position = position;
+            granulator.processBlock(inputs, outputs, blockSize, blockParameters);
+        }
+        else
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                FloatVectorOperations::clear(cloudSamples[channel], blockSize);
         }
 
-        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+        for (int i = 0; i < blockSize; i++)
         {
-            float cloudSample = 0.f;
-            auto* channelData = buffer.getWritePointer (channel);
-            if (activateRecording) {
-                granulator[channel].setRecording(true);
+            portLastSample = portTarget + (portLastSample - portTarget) * 0.9999;
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* channelData = buffer.getWritePointer (channel, start);
+                channelData[i] = channelData[i] + (cloudSamples[channel][i] - channelData[i]) * portLastSample;
             }
-            granulator[channel].setDensity(density);
-            granulator[channel].setPitch(pitch);
-            granulator[channel].setDuration(duration);
-            granulator[channel].setPosition(position);
-            if (isActive)
-                cloudSample = granulator[channel].process(channelData[i]);
-            channelData[i] = channelData[i] + (cloudSample - channelData[i]) * portLastSample;
         }
-        isActive = (bool)*activeParameter;
+        start += blockSize;
     }
 }
 
@@ -273,6 +326,35 @@ void Plugex_35_granularSoundcloudAudioProcessor::setStateInformation (const void
     // whose contents will have been created by the getStateInformation() call.
 }
 
+//==============================================================================
+bool Plugex_35_granularSoundcloudAudioProcessor::loadSourceFile (const File& file)
+{
+    std::unique_ptr<GranularFileSource> newSource;
+    if (file != File())
+    {
+        newSource.reset (new GranularFileSource());
+        if (! newSource->open (file))
+            return false;
+    }
+
+    // Released after the lock, the audio thread only tries to take it.
+    std::unique_ptr<GranularFileSource> unused[2];
+    {
+        const SpinLock::ScopedLockType lock (sourceLock);
+        unused[0] = std::move (retiredSource);
+        unused[1] = std::move (pendingSource);
+        pendingSource = std::move (newSource);
+        sourceChangePending = true;
+    }
+    sourceFile = file;
+    return true;
+}
+
+File Plugex_35_granularSoundcloudAudioProcessor::getSourceFile() const
+{
+    return sourceFile;
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
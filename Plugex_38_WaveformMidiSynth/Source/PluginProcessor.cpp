@@ -15,8 +15,8 @@
 static const int numberOfVoices = 10;
 
 //==============================================================================
-MySynthesiserVoice::MySynthesiserVoice() {
-    oscillator.setup(getSampleRate());
+MySynthesiserVoice::MySynthesiserVoice(int voiceIndex) {
+    oscillator.setup(getSampleRate(), voiceIndex);
     envelope.setSampleRate(getSampleRate());
 }
 
@@ -159,7 +159,7 @@ Plugex_38_waveformMidiSynthAudioProcessor::Plugex_38_waveformMidiSynthAudioProce
 {
 
     for (auto i = 0; i < numberOfVoices; ++i)
-        synthesiser.addVoice(new MySynthesiserVoice());
+        synthesiser.addVoice(new MySynthesiserVoice(i));
 
     synthesiser.addSound(new MySynthesiserSound());
 
@@ -25,7 +25,8 @@ struct MySynthesiserSound   : public SynthesiserSound
 //==============================================================================
 struct MySynthesiserVoice   : public SynthesiserVoice
 {
-    MySynthesiserVoice();
+    // The voice index keeps the random generators of the voices apart.
+    MySynthesiserVoice(int voiceIndex);
 
     void pitchWheelMoved (int) override      {}
     void controllerMoved (int, int) override {}
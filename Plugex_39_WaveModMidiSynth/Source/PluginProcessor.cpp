@@ -15,11 +15,11 @@
 static const int numberOfVoices = 10;
 
 //==============================================================================
-MySynthesiserVoice::MySynthesiserVoice() {
-    lfo.setup(getSampleRate());
+MySynthesiserVoice::MySynthesiserVoice(int voiceIndex) {
+    lfo.setup(getSampleRate(), voiceIndex * 3);
     lfo.setSharp(1.f);
-    oscillatorLeft.setup(getSampleRate());
-    oscillatorRight.setup(getSampleRate());
+    oscillatorLeft.setup(getSampleRate(), voiceIndex * 3 + 1);
+    oscillatorRight.setup(getSampleRate(), voiceIndex * 3 + 2);
     envelope.setSampleRate(getSampleRate());
 }
 
@@ -304,7 +304,7 @@ Plugex_39_waveModMidiSynthAudioProcessor::Plugex_39_waveModMidiSynthAudioProcess
 {
 
     for (auto i = 0; i < numberOfVoices; ++i)
-        synthesiser.addVoice(new MySynthesiserVoice());
+        synthesiser.addVoice(new MySynthesiserVoice(i));
 
     synthesiser.addSound(new MySynthesiserSound());
 
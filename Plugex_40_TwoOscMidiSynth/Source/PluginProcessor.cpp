@@ -15,13 +15,13 @@
 static const int numberOfVoices = 8;
 
 //==============================================================================
-MySynthesiserVoice::MySynthesiserVoice() {
-    lfo1.setup(getSampleRate());
-    lfo2.setup(getSampleRate());
-    oscillator1Left.setup(getSampleRate());
-    oscillator1Right.setup(getSampleRate());
-    oscillator2Left.setup(getSampleRate());
-    oscillator2Right.setup(getSampleRate());
+MySynthesiserVoice::MySynthesiserVoice(int voiceIndex) {
+    lfo1.setup(getSampleRate(), voiceIndex * 6);
+    lfo2.setup(getSampleRate(), voiceIndex * 6 + 1);
+    oscillator1Left.setup(getSampleRate(), voiceIndex * 6 + 2);
+    oscillator1Right.setup(getSampleRate(), voiceIndex * 6 + 3);
+    oscillator2Left.setup(getSampleRate(), voiceIndex * 6 + 4);
+    oscillator2Right.setup(getSampleRate(), voiceIndex * 6 + 5);
     envelope.setSampleRate(getSampleRate());
     smoothedGain1.reset(256);
     smoothedGain2.reset(256);
@@ -583,7 +583,7 @@ Plugex_40_twoOscMidiSynthAudioProcessor::Plugex_40_twoOscMidiSynthAudioProcessor
 {
 
     for (auto i = 0; i < numberOfVoices; ++i)
-        synthesiser.addVoice(new MySynthesiserVoice());
+        synthesiser.addVoice(new MySynthesiserVoice(i));
 
     synthesiser.addSound(new MySynthesiserSound());
 
@@ -9,8 +9,6 @@
 *
 *******************************************************************************/
 
-#include <time.h>
-#include <stdlib.h>
 #include <math.h>
 #include "BandLimitedOsc.h"
 
@@ -22,12 +20,11 @@ BandLimitedOsc::BandLimitedOsc() {
     m_wavetype = 2;
     m_freq = 1.f;
     m_sharp = 0.f;
-    srand((unsigned int)time(0));
     m_sah_last_value = 0.f;
-    m_sah_current_value = (rand() / (float)RAND_MAX) * 2.f - 1.f;
+    m_sah_current_value = m_random.nextBipolar();
 }
 
-void BandLimitedOsc::setup(float sampleRate) {
+void BandLimitedOsc::setup(float sampleRate, int randomSalt) {
     m_sampleRate = sampleRate;
     m_oneOverSr = 1.f / m_sampleRate;
     m_twopi = 2.f * M_PI;
@@ -35,6 +32,9 @@ void BandLimitedOsc::setup(float sampleRate) {
     m_srOverFour = m_sampleRate / 4.f;
     m_srOverEight = m_sampleRate / 8.f;
     m_pointer_pos = m_sah_pointer_pos = 0.f;
+    m_random.reseed(randomSalt);
+    m_sah_last_value = 0.f;
+    m_sah_current_value = m_random.nextBipolar();
 }
 
 BandLimitedOsc::~BandLimitedOsc() {}
@@ -152,7 +152,7 @@ float BandLimitedOsc::process() {
                 m_pointer_pos -= 1.f;
                 m_sah_pointer_pos = 0.f;
                 m_sah_last_value = m_sah_current_value;
-                m_sah_current_value = (rand() / (float)RAND_MAX) * 2.f - 1.f;
+                m_sah_current_value = m_random.nextBipolar();
             }
             if (m_sah_pointer_pos < 1.f) {
                 fade = 0.5f * sinf(M_PI * (m_sah_pointer_pos + 0.5f)) + 0.5f;
@@ -11,11 +11,15 @@
 
 #pragma once
 
+#include "FastRandom.h"
+
 class BandLimitedOsc {
     public:
         BandLimitedOsc();
         ~BandLimitedOsc();
-        void setup(float sampleRate);
+        // The salt tells apart the oscillators of an owner when the random
+        // generator has a fixed seed (see FastRandom).
+        void setup(float sampleRate, int randomSalt = 0);
         void setWavetype(int type);
         void setFreq(float freq);
         void setSharp(float sharp);
@@ -41,6 +45,7 @@ class BandLimitedOsc {
         float m_sah_pointer_pos;
         float m_sah_last_value;
         float m_sah_current_value;
+        FastRandom m_random;
 
         // private methods
         float _clip(float x);
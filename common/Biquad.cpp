@@ -107,6 +107,14 @@ void Biquad::computeCoefficients() {
     }
 }
 
+void Biquad::getCoefficients(float *coefficients) {
+    coefficients[0] = b0 * a0;
+    coefficients[1] = b1 * a0;
+    coefficients[2] = b2 * a0;
+    coefficients[3] = a1 * a0;
+    coefficients[4] = a2 * a0;
+}
+
 float Biquad::process(float input) {
     float out = ( b0 * input + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2 ) * a0;
     x2 = x1; x1 = input; y2 = y1; y1 = out;
@@ -22,6 +22,8 @@ class Biquad {
         void setParameters(float freq, float q, int type);
         void computeVariables();
         void computeCoefficients();
+        // b0, b1, b2, a1, a2, normalized by a0.
+        void getCoefficients(float *coefficients);
         float process(float input);
 
     private:
@@ -0,0 +1,56 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+#include "DelayLine.h"
+
+/* Chorus voices reading modulated taps of one delay line per channel. The
+   state of the voices is kept in arrays (one array per field), so the LFOs
+   and the delay times of all the voices are computed in SIMD lanes and the
+   taps are read together by DelayLine::readTaps(). */
+class ChorusEngine {
+    public:
+        enum {
+            maxChannels = 2,
+            minVoices = 4,
+            maxVoices = 32
+        };
+
+        ChorusEngine();
+        ~ChorusEngine();
+        void setup(double sampleRate);
+        void setNumberOfVoices(int numberOfVoices);
+        int getNumberOfVoices();
+        /* Writes input in the delay line of channel and returns the sum of
+           the voices. depth scales the delay deviations (0 to 2) and each
+           voice feeds back feedback / numberOfVoices of its tap. */
+        float process(int channel, float input, float depth, float feedback);
+
+    private:
+        void computeVoices();
+
+        double m_sampleRate;
+        int m_numVoices;
+        float m_gain;
+
+        // Delays in samples, LFO phases between 0 and 1.
+        alignas(32) float m_centerDelays[maxVoices];
+        alignas(32) float m_delayDeviations[maxVoices];
+        alignas(32) float m_phases[maxChannels][maxVoices];
+        alignas(32) float m_increments[maxChannels][maxVoices];
+        alignas(32) float m_delays[maxVoices];
+        alignas(32) float m_taps[maxVoices];
+
+        // Both lines in one block. Hermite keeps the highs of the modulated taps.
+        DelayArena m_arena;
+        DelayLine<DelayLineInterpolation::Hermite> m_delayLines[maxChannels];
+};
@@ -10,42 +10,399 @@
 *******************************************************************************/
 
 #include <algorithm>
+#include <cmath>
+#include <type_traits>
 #include "DelayLine.h"
 
-DelayLine::DelayLine() {}
+// The linear and Hermite taps are read 8 at a time with AVX2 gathers, 4 at a
+// time with SSE2 or NEON (positions in lanes, staged sample loads), then one
+// by one.
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  #define DELAYLINE_USE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define DELAYLINE_USE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define DELAYLINE_USE_NEON 1
+#endif
 
-DelayLine::~DelayLine() {}
+DelayArena::DelayArena(size_t maximumBytes) {
+    m_maximumBytes = maximumBytes;
+    m_capacity = 0;
+    clear();
+}
+
+DelayArena::~DelayArena() {}
+
+void DelayArena::clear() {
+    m_buffers.clear();
+    m_requestedBytes = 0;
+    m_reserved = 0;
+    m_overBudget = false;
+}
+
+int DelayArena::reserve(float **buffer, int numSamples) {
+    const size_t floatsPerLine = alignment / sizeof(float);
+    size_t available = m_maximumBytes / sizeof(float);
+    available = available > m_reserved ? available - m_reserved : 0;
+    int granted = numSamples;
+    while (granted > 1 && static_cast<size_t> (granted) > available) {
+        granted >>= 1;
+    }
+    if (granted < numSamples) {
+        m_overBudget = true;
+    }
+    m_requestedBytes += numSamples * sizeof(float);
+    m_buffers.push_back({buffer, m_reserved});
+    m_reserved += (granted + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    return granted;
+}
+
+void DelayArena::allocate() {
+    const size_t floatsPerLine = alignment / sizeof(float);
+    if (m_reserved > m_capacity) {
+        // Room to move the start of the block on a cache line.
+        block.reset( new float[m_reserved + floatsPerLine] );
+        m_capacity = m_reserved;
+    }
+    if (m_capacity == 0) {
+        return;
+    }
+    size_t misalignment = reinterpret_cast<size_t> (block.get()) % alignment;
+    float *start = block.get() + (misalignment ? (alignment - misalignment) / sizeof(float) : 0);
+    std::fill(start, start + m_reserved, 0.f);
+    for (const Buffer &buffer : m_buffers) {
+        *buffer.destination = start + buffer.offset;
+    }
+}
+
+void DelayArena::setMaximumBytes(size_t maximumBytes) {
+    m_maximumBytes = maximumBytes;
+}
+
+size_t DelayArena::getMaximumBytes() {
+    return m_maximumBytes;
+}
+
+size_t DelayArena::getRequestedBytes() {
+    return m_requestedBytes;
+}
+
+size_t DelayArena::getReservedBytes() {
+    return m_reserved * sizeof(float);
+}
+
+int DelayArena::getNumberOfBuffers() {
+    return static_cast<int> (m_buffers.size());
+}
+
+bool DelayArena::isOverBudget() {
+    return m_overBudget;
+}
+
+// Linearly interpolated taps in SIMD lanes, returns the number of taps read.
+static int readLinearTaps(const float *samples, int writePosition, int mask,
+                          const float *delaysInSamples, float *taps, int numTaps) {
+    int k = 0;
+
+#if DELAYLINE_USE_AVX2
+    const __m256i write8 = _mm256_set1_epi32(writePosition);
+    const __m256i mask8 = _mm256_set1_epi32(mask);
+    const __m256i one8 = _mm256_set1_epi32(1);
+    for ( ; k + 8 <= numTaps; k += 8) {
+        __m256 delay = _mm256_loadu_ps(delaysInSamples + k);
+        __m256i integerPart = _mm256_cvttps_epi32(delay);
+        __m256 floatPart = _mm256_sub_ps(delay, _mm256_cvtepi32_ps(integerPart));
+        __m256i position = _mm256_and_si256(_mm256_sub_epi32(write8, integerPart), mask8);
+        __m256i previousPosition = _mm256_and_si256(_mm256_sub_epi32(position, one8), mask8);
+        __m256 current = _mm256_i32gather_ps(samples, position, 4);
+        __m256 previous = _mm256_i32gather_ps(samples, previousPosition, 4);
+        _mm256_storeu_ps(taps + k, _mm256_add_ps(current, _mm256_mul_ps(_mm256_sub_ps(previous, current), floatPart)));
+    }
+#endif
+
+#if DELAYLINE_USE_SSE2 || DELAYLINE_USE_NEON
+    alignas(16) int position[4];
+    alignas(16) float current[4], previous[4];
+  #if DELAYLINE_USE_SSE2
+    const __m128i write4 = _mm_set1_epi32(writePosition);
+    const __m128i mask4 = _mm_set1_epi32(mask);
+  #else
+    const int32x4_t write4 = vdupq_n_s32(writePosition);
+    const int32x4_t mask4 = vdupq_n_s32(mask);
+  #endif
+    for ( ; k + 4 <= numTaps; k += 4) {
+  #if DELAYLINE_USE_SSE2
+        __m128 delay = _mm_loadu_ps(delaysInSamples + k);
+        __m128i integerPart = _mm_cvttps_epi32(delay);
+        __m128 floatPart = _mm_sub_ps(delay, _mm_cvtepi32_ps(integerPart));
+        _mm_store_si128((__m128i *)position, _mm_and_si128(_mm_sub_epi32(write4, integerPart), mask4));
+  #else
+        float32x4_t delay = vld1q_f32(delaysInSamples + k);
+        int32x4_t integerPart = vcvtq_s32_f32(delay);
+        float32x4_t floatPart = vsubq_f32(delay, vcvtq_f32_s32(integerPart));
+        vst1q_s32(position, vandq_s32(vsubq_s32(write4, integerPart), mask4));
+  #endif
+        for (int i = 0; i < 4; i++) {
+            current[i] = samples[position[i]];
+            previous[i] = samples[(position[i] - 1) & mask];
+        }
+  #if DELAYLINE_USE_SSE2
+        __m128 c = _mm_load_ps(current);
+        _mm_storeu_ps(taps + k, _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(previous), c), floatPart)));
+  #else
+        float32x4_t c = vld1q_f32(current);
+        vst1q_f32(taps + k, vmlaq_f32(c, vsubq_f32(vld1q_f32(previous), c), floatPart));
+  #endif
+    }
+#endif
+
+    return k;
+}
+
+// Same for the 4-point Hermite taps, with the arithmetic of
+// DelayLineInterpolation::Hermite done in the lanes.
+static int readHermiteTaps(const float *samples, int writePosition, int mask,
+                           const float *delaysInSamples, float *taps, int numTaps) {
+    int k = 0;
+
+#if DELAYLINE_USE_AVX2
+    const __m256i write8 = _mm256_set1_epi32(writePosition);
+    const __m256i mask8 = _mm256_set1_epi32(mask);
+    const __m256i one8 = _mm256_set1_epi32(1);
+    const __m256i two8 = _mm256_set1_epi32(2);
+    const __m256 half8 = _mm256_set1_ps(0.5f);
+    const __m256 onePointFive8 = _mm256_set1_ps(1.5f);
+    const __m256 twoPointFive8 = _mm256_set1_ps(2.5f);
+    for ( ; k + 8 <= numTaps; k += 8) {
+        __m256 delay = _mm256_loadu_ps(delaysInSamples + k);
+        __m256i integerPart = _mm256_cvttps_epi32(delay);
+        __m256 f = _mm256_sub_ps(delay, _mm256_cvtepi32_ps(integerPart));
+        __m256i position = _mm256_and_si256(_mm256_sub_epi32(write8, integerPart), mask8);
+        __m256 xm1 = _mm256_i32gather_ps(samples, _mm256_and_si256(_mm256_add_epi32(position, one8), mask8), 4);
+        __m256 x0 = _mm256_i32gather_ps(samples, position, 4);
+        __m256 x1 = _mm256_i32gather_ps(samples, _mm256_and_si256(_mm256_sub_epi32(position, one8), mask8), 4);
+        __m256 x2 = _mm256_i32gather_ps(samples, _mm256_and_si256(_mm256_sub_epi32(position, two8), mask8), 4);
+        __m256 c1 = _mm256_mul_ps(half8, _mm256_sub_ps(x1, xm1));
+        __m256 c2 = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(xm1, _mm256_mul_ps(twoPointFive8, x0)), _mm256_add_ps(x1, x1)),
+                                  _mm256_mul_ps(half8, x2));
+        __m256 c3 = _mm256_add_ps(_mm256_mul_ps(half8, _mm256_sub_ps(x2, xm1)), _mm256_mul_ps(onePointFive8, _mm256_sub_ps(x0, x1)));
+        __m256 y = _mm256_add_ps(_mm256_mul_ps(c3, f), c2);
+        y = _mm256_add_ps(_mm256_mul_ps(y, f), c1);
+        _mm256_storeu_ps(taps + k, _mm256_add_ps(_mm256_mul_ps(y, f), x0));
+    }
+#endif
 
-void DelayLine::setup(float maxDelayTime, double sampleRate) {
+#if DELAYLINE_USE_SSE2 || DELAYLINE_USE_NEON
+    alignas(16) int position[4];
+    alignas(16) float points[4][4];
+  #if DELAYLINE_USE_SSE2
+    const __m128i write4 = _mm_set1_epi32(writePosition);
+    const __m128i mask4 = _mm_set1_epi32(mask);
+    const __m128 half4 = _mm_set1_ps(0.5f);
+    const __m128 onePointFive4 = _mm_set1_ps(1.5f);
+    const __m128 twoPointFive4 = _mm_set1_ps(2.5f);
+  #else
+    const int32x4_t write4 = vdupq_n_s32(writePosition);
+    const int32x4_t mask4 = vdupq_n_s32(mask);
+  #endif
+    for ( ; k + 4 <= numTaps; k += 4) {
+  #if DELAYLINE_USE_SSE2
+        __m128 delay = _mm_loadu_ps(delaysInSamples + k);
+        __m128i integerPart = _mm_cvttps_epi32(delay);
+        __m128 f = _mm_sub_ps(delay, _mm_cvtepi32_ps(integerPart));
+        _mm_store_si128((__m128i *)position, _mm_and_si128(_mm_sub_epi32(write4, integerPart), mask4));
+  #else
+        float32x4_t delay = vld1q_f32(delaysInSamples + k);
+        int32x4_t integerPart = vcvtq_s32_f32(delay);
+        float32x4_t f = vsubq_f32(delay, vcvtq_f32_s32(integerPart));
+        vst1q_s32(position, vandq_s32(vsubq_s32(write4, integerPart), mask4));
+  #endif
+        for (int i = 0; i < 4; i++) {
+            points[0][i] = samples[(position[i] + 1) & mask];
+            points[1][i] = samples[position[i]];
+            points[2][i] = samples[(position[i] - 1) & mask];
+            points[3][i] = samples[(position[i] - 2) & mask];
+        }
+  #if DELAYLINE_USE_SSE2
+        __m128 xm1 = _mm_load_ps(points[0]), x0 = _mm_load_ps(points[1]);
+        __m128 x1 = _mm_load_ps(points[2]), x2 = _mm_load_ps(points[3]);
+        __m128 c1 = _mm_mul_ps(half4, _mm_sub_ps(x1, xm1));
+        __m128 c2 = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(xm1, _mm_mul_ps(twoPointFive4, x0)), _mm_add_ps(x1, x1)),
+                               _mm_mul_ps(half4, x2));
+        __m128 c3 = _mm_add_ps(_mm_mul_ps(half4, _mm_sub_ps(x2, xm1)), _mm_mul_ps(onePointFive4, _mm_sub_ps(x0, x1)));
+        __m128 y = _mm_add_ps(_mm_mul_ps(c3, f), c2);
+        y = _mm_add_ps(_mm_mul_ps(y, f), c1);
+        _mm_storeu_ps(taps + k, _mm_add_ps(_mm_mul_ps(y, f), x0));
+  #else
+        float32x4_t xm1 = vld1q_f32(points[0]), x0 = vld1q_f32(points[1]);
+        float32x4_t x1 = vld1q_f32(points[2]), x2 = vld1q_f32(points[3]);
+        float32x4_t c1 = vmulq_n_f32(vsubq_f32(x1, xm1), 0.5f);
+        float32x4_t c2 = vmlsq_n_f32(vaddq_f32(vmlsq_n_f32(xm1, x0, 2.5f), vaddq_f32(x1, x1)), x2, 0.5f);
+        float32x4_t c3 = vmlaq_n_f32(vmulq_n_f32(vsubq_f32(x2, xm1), 0.5f), vsubq_f32(x0, x1), 1.5f);
+        float32x4_t y = vmlaq_f32(c2, c3, f);
+        y = vmlaq_f32(c1, y, f);
+        vst1q_f32(taps + k, vmlaq_f32(x0, y, f));
+  #endif
+    }
+#endif
+
+    return k;
+}
+
+template <typename Interpolation>
+DelayLine<Interpolation>::DelayLine() {
+    m_sampleRate = 44100.0;
+    m_size = 1;
+    m_mask = 0;
+    m_writePosition = 0;
+    m_buffer = nullptr;
+}
+
+template <typename Interpolation>
+DelayLine<Interpolation>::~DelayLine() {}
+
+template <typename Interpolation>
+void DelayLine<Interpolation>::setup(float maxDelayTime, double sampleRate, int maxBlockSize) {
+    setSize(maxDelayTime, sampleRate, maxBlockSize);
+    data.reset( new float[m_size] );
+    m_buffer = data.get();
+    std::fill(m_buffer, m_buffer + m_size, 0.f);
+}
+
+template <typename Interpolation>
+void DelayLine<Interpolation>::setup(DelayArena &arena, float maxDelayTime, double sampleRate, int maxBlockSize) {
+    setSize(maxDelayTime, sampleRate, maxBlockSize);
+    m_size = arena.reserve(&m_buffer, m_size);
+    m_mask = m_size - 1;
+    data.reset();
+}
+
+template <typename Interpolation>
+void DelayLine<Interpolation>::setSize(float maxDelayTime, double sampleRate, int maxBlockSize) {
+    // The block readers reach back maxBlockSize samples more than the
+    // longest delay, plus the older samples of the interpolation.
+    long needed = static_cast<long> (maxDelayTime * sampleRate + 0.5) + (maxBlockSize > 0 ? maxBlockSize : 1) +
+                  Interpolation::extent;
+    m_size = 1;
+    while (m_size < needed && m_size < (1 << 30)) {
+        m_size <<= 1;
+    }
+    m_mask = m_size - 1;
     m_writePosition = 0;
-    m_maxSize = static_cast<int> (maxDelayTime * sampleRate + 0.5);
     m_sampleRate = sampleRate;
-    data.reset( new float[m_maxSize + 1] );
-    std::fill(data.get(), data.get() + m_maxSize + 1, 0.f);
+    for (int k = 0; k < maxTaps; k++) {
+        m_states[k] = typename Interpolation::State();
+    }
+}
+
+template <typename Interpolation>
+float DelayLine<Interpolation>::read(float delayTime) {
+    return readSamples(delayTime * static_cast<float> (m_sampleRate));
+}
+
+template <typename Interpolation>
+float DelayLine<Interpolation>::readSamples(float delayInSamples) {
+    // The integer part of the delay is subtracted from the write position
+    // and the fraction interpolates towards the older samples, so the
+    // precision does not depend on the size of the buffer.
+    int delayIntegerPart = static_cast<int> (delayInSamples);
+    float delayFloatPart = delayInSamples - delayIntegerPart;
+    int position = (m_writePosition - delayIntegerPart) & m_mask;
+    return Interpolation::interpolate(m_buffer, position, m_mask, delayFloatPart, m_states[0]);
 }
 
-float DelayLine::read(float delayTime) {
-    float delayTimeInSamples = delayTime * m_sampleRate;
-    float readPosition = m_writePosition - delayTimeInSamples;
-    if (readPosition < 0) {
-        readPosition += m_maxSize;
-    } else if (readPosition >= m_maxSize) {
-        readPosition -= m_maxSize;
+template <typename Interpolation>
+void DelayLine<Interpolation>::write(float input) {
+    m_buffer[m_writePosition] = input;
+    m_writePosition = (m_writePosition + 1) & m_mask;
+}
+
+template <typename Interpolation>
+void DelayLine<Interpolation>::writeBlock(const float *input, int numSamples) {
+    // At most two copies, one up to the end of the buffer and one from its start.
+    while (numSamples > 0) {
+        int count = std::min(numSamples, m_size - m_writePosition);
+        std::copy(input, input + count, m_buffer + m_writePosition);
+        m_writePosition = (m_writePosition + count) & m_mask;
+        input += count;
+        numSamples -= count;
     }
-    int readPosIntegerPart = static_cast<int>(readPosition);
-    float readPosFloatPart = readPosition - readPosIntegerPart;
-    float previous = data[readPosIntegerPart];
-    float next = data[readPosIntegerPart + 1];
-    return previous + (next - previous) * readPosFloatPart;
 }
 
-void DelayLine::write(float input) {
-    data[m_writePosition] = input;
-    if (m_writePosition == 0) {
-        data[m_maxSize] = input;
+template <typename Interpolation>
+void DelayLine<Interpolation>::readBlock(float *output, int numSamples, float delayInSamples) {
+    if (Interpolation::order == 0) {
+        delayInSamples = std::floor(delayInSamples + 0.5f);
     }
-    m_writePosition++;
-    if (m_writePosition == m_maxSize) {
-        m_writePosition = 0;
+    int delayIntegerPart = static_cast<int> (delayInSamples);
+    float delayFloatPart = delayInSamples - delayIntegerPart;
+    int position = (m_writePosition - numSamples - delayIntegerPart) & m_mask;
+
+    // Whole delays are copied, except by the allpass which has to run.
+    if (delayFloatPart == 0.f && std::is_empty<typename Interpolation::State>::value) {
+        while (numSamples > 0) {
+            int count = std::min(numSamples, m_size - position);
+            std::copy(m_buffer + position, m_buffer + position + count, output);
+            position = (position + count) & m_mask;
+            output += count;
+            numSamples -= count;
+        }
+        return;
+    }
+
+    const float *samples = m_buffer;
+    for (int i = 0; i < numSamples; i++) {
+        output[i] = Interpolation::interpolate(samples, (position + i) & m_mask, m_mask, delayFloatPart, m_states[0]);
     }
 }
+
+template <typename Interpolation>
+void DelayLine<Interpolation>::readBlock(float *output, int numSamples, const float *delayInSamples) {
+    const float *samples = m_buffer;
+    int start = m_writePosition - numSamples;
+    for (int i = 0; i < numSamples; i++) {
+        int delayIntegerPart = static_cast<int> (delayInSamples[i]);
+        float delayFloatPart = delayInSamples[i] - delayIntegerPart;
+        int position = (start + i - delayIntegerPart) & m_mask;
+        output[i] = Interpolation::interpolate(samples, position, m_mask, delayFloatPart, m_states[0]);
+    }
+}
+
+template <typename Interpolation>
+void DelayLine<Interpolation>::readTaps(const float *delaysInSamples, float *taps, int numTaps) {
+    const float *samples = m_buffer;
+    int k = 0;
+    if (std::is_same<Interpolation, DelayLineInterpolation::Linear>::value) {
+        k = readLinearTaps(samples, m_writePosition, m_mask, delaysInSamples, taps, numTaps);
+    } else if (std::is_same<Interpolation, DelayLineInterpolation::Hermite>::value) {
+        k = readHermiteTaps(samples, m_writePosition, m_mask, delaysInSamples, taps, numTaps);
+    }
+
+    for ( ; k < numTaps; k++) {
+        int delayIntegerPart = static_cast<int> (delaysInSamples[k]);
+        float delayFloatPart = delaysInSamples[k] - delayIntegerPart;
+        int position = (m_writePosition - delayIntegerPart) & m_mask;
+        taps[k] = Interpolation::interpolate(samples, position, m_mask, delayFloatPart, m_states[k]);
+    }
+}
+
+template <typename Interpolation>
+void DelayLine<Interpolation>::processTaps(float input, const float *delaysInSamples, const float *feedbacks,
+                                           float *taps, int numTaps) {
+    readTaps(delaysInSamples, taps, numTaps);
+    float feedback = 0.f;
+    for (int k = 0; k < numTaps; k++) {
+        feedback += taps[k] * feedbacks[k];
+    }
+    write(input + feedback);
+}
+
+template class DelayLine<DelayLineInterpolation::None>;
+template class DelayLine<DelayLineInterpolation::Linear>;
+template class DelayLine<DelayLineInterpolation::Hermite>;
+template class DelayLine<DelayLineInterpolation::Lagrange3>;
+template class DelayLine<DelayLineInterpolation::Allpass>;
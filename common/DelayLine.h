@@ -11,20 +11,184 @@
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
+#include <vector>
 
+/* Interpolation policies of DelayLine. A delay of n + fraction samples is
+   read between the sample at delay n and the older one at delay n + 1.
+   extent is how many samples older than n are read, and the 4-point policies
+   also read the newer sample at delay n - 1, so their delays must be at least
+   2 samples. A policy with a State keeps one state per reader and must be
+   read once per sample. */
+namespace DelayLineInterpolation {
+    // Nearest sample.
+    struct None {
+        enum { order = 0, extent = 1 };
+        struct State {};
+        static inline float interpolate(const float *samples, int position, int mask,
+                                        float fraction, State &) {
+            return fraction < 0.5f ? samples[position] : samples[(position - 1) & mask];
+        }
+    };
+
+    struct Linear {
+        enum { order = 1, extent = 1 };
+        struct State {};
+        static inline float interpolate(const float *samples, int position, int mask,
+                                        float fraction, State &) {
+            float current = samples[position];
+            return current + (samples[(position - 1) & mask] - current) * fraction;
+        }
+    };
+
+    // 4-point, 3rd-order Hermite (Catmull-Rom).
+    struct Hermite {
+        enum { order = 3, extent = 2 };
+        struct State {};
+        static inline float interpolate(const float *samples, int position, int mask,
+                                        float fraction, State &) {
+            float xm1 = samples[(position + 1) & mask];
+            float x0 = samples[position];
+            float x1 = samples[(position - 1) & mask];
+            float x2 = samples[(position - 2) & mask];
+            float c1 = 0.5f * (x1 - xm1);
+            float c2 = xm1 - 2.5f * x0 + 2.f * x1 - 0.5f * x2;
+            float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+            return ((c3 * fraction + c2) * fraction + c1) * fraction + x0;
+        }
+    };
+
+    // 3rd-order Lagrange polynomial through the same 4 points.
+    struct Lagrange3 {
+        enum { order = 3, extent = 2 };
+        struct State {};
+        static inline float interpolate(const float *samples, int position, int mask,
+                                        float fraction, State &) {
+            float xm1 = samples[(position + 1) & mask];
+            float x0 = samples[position];
+            float x1 = samples[(position - 1) & mask];
+            float x2 = samples[(position - 2) & mask];
+            float dp1 = fraction + 1.f;
+            float dm1 = fraction - 1.f;
+            float dm2 = fraction - 2.f;
+            float a = dm1 * dm2;
+            float b = dp1 * fraction;
+            return (x2 * b * dm1 - xm1 * fraction * a) * (1.f / 6.f) +
+                   (x0 * dp1 * a - x1 * b * dm2) * 0.5f;
+        }
+    };
+
+    /* First-order allpass: flat magnitude, the fraction only shifts the phase.
+       It filters its previous output, so it suits slowly moving delays. */
+    struct Allpass {
+        enum { order = 1, extent = 1 };
+        struct State {
+            State() : lastOutput(0.f) {}
+            float lastOutput;
+        };
+        static inline float interpolate(const float *samples, int position, int mask,
+                                        float fraction, State &state) {
+            float coefficient = (1.f - fraction) / (1.f + fraction);
+            float output = samples[(position - 1) & mask] + coefficient * (samples[position] - state.lastOutput);
+            state.lastOutput = output;
+            return output;
+        }
+    };
+}
+
+/* One aligned allocation shared by the delay lines of a processor. The lines
+   declare their buffers with DelayLine::setup(arena, ...), then allocate()
+   carves them from a single block, one after the other, each starting on a
+   cache line. The lines must not move between their setup() and allocate()
+   and must not be read before allocate(). */
+class DelayArena {
+    public:
+        enum { alignment = 64 };
+
+        explicit DelayArena(size_t maximumBytes = 64 << 20);
+        ~DelayArena();
+        // Forgets the buffers declared so far, the block is kept for reuse.
+        void clear();
+        /* Declares a buffer of numSamples floats (a power of two) and returns
+           the number granted: numSamples, or the largest power of two that
+           still fits in the maximum size (at least 1). */
+        int reserve(float **buffer, int numSamples);
+        // Allocates the block if it is too small, clears it and hands out the buffers.
+        void allocate();
+
+        void setMaximumBytes(size_t maximumBytes);
+        size_t getMaximumBytes();
+        // Memory report: bytes asked for, bytes granted (padding included),
+        // and whether a buffer was shrunk to stay under the maximum.
+        size_t getRequestedBytes();
+        size_t getReservedBytes();
+        int getNumberOfBuffers();
+        bool isOverBudget();
+
+    private:
+        struct Buffer {
+            float **destination;
+            size_t offset;
+        };
+
+        size_t m_maximumBytes;
+        size_t m_requestedBytes;
+        // Floats reserved, and floats in the current block.
+        size_t m_reserved;
+        size_t m_capacity;
+        bool m_overBudget;
+        std::vector<Buffer> m_buffers;
+        std::unique_ptr<float[]> block;
+};
+
+/* Circular buffer whose size is rounded up to a power of two, so that the
+   positions wrap with a mask. Delays are read before the sample of the same
+   instant is written, a delay of 1 sample returns the last written one.
+   Interpolation is one of the DelayLineInterpolation policies, chosen at
+   compile time (the policies are instantiated in DelayLine.cpp). */
+template <typename Interpolation = DelayLineInterpolation::Linear>
 class DelayLine {
     public:
+        // Readers with their own interpolation state: the taps of readTaps(),
+        // read() and the block readers use the state of tap 0.
+        enum { maxTaps = 32 };
+
         DelayLine();
         ~DelayLine();
-        void setup(float maxDelayTime, double sampleRate);
+        // maxBlockSize is the longest block given to writeBlock()/readBlock().
+        void setup(float maxDelayTime, double sampleRate, int maxBlockSize = 0);
+        // Same, with the buffer taken from arena once it is allocated.
+        void setup(DelayArena &arena, float maxDelayTime, double sampleRate, int maxBlockSize = 0);
         float read(float delayTime);
+        float readSamples(float delayInSamples);
         void write(float input);
 
+        /* Block versions, to call after writeBlock() of the same samples:
+           output[i] is what read() would have given just before input[i]
+           was written. The delay is either fixed or given for each sample. */
+        void writeBlock(const float *input, int numSamples);
+        void readBlock(float *output, int numSamples, float delayInSamples);
+        void readBlock(float *output, int numSamples, const float *delayInSamples);
+
+        /* Multi-tap reader: numTaps delays (in samples, numTaps <= maxTaps)
+           are read from the same buffer in one pass, several taps at a time
+           in SIMD lanes for the linear and Hermite policies. processTaps() then writes
+           input plus the taps weighted by feedbacks, one gain per tap. */
+        void readTaps(const float *delaysInSamples, float *taps, int numTaps);
+        void processTaps(float input, const float *delaysInSamples, const float *feedbacks,
+                         float *taps, int numTaps);
+
     private:
+        void setSize(float maxDelayTime, double sampleRate, int maxBlockSize);
+
         double m_sampleRate;
-        long m_maxSize;
-        float m_writePosition;
+        int m_size;
+        int m_mask;
+        int m_writePosition;
 
+        // The samples, in data or in an arena.
+        float *m_buffer;
         std::unique_ptr<float[]> data;
+        typename Interpolation::State m_states[maxTaps];
 };
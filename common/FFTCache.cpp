@@ -0,0 +1,46 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#include "FFTCache.h"
+#include "Windowing.h"
+
+FFTCache::FFTCache() {}
+
+FFTCache::~FFTCache() {}
+
+const dsp::FFT * FFTCache::getPlan(int order) {
+    jassert (order >= 0 && order <= maxOrder);
+    const ScopedLock sl (lock);
+    if (plans[order] == nullptr)
+        plans[order].reset(new dsp::FFT(order));
+    return plans[order].get();
+}
+
+FFTCache::WindowTable::Ptr FFTCache::getWindow(int size, int type) {
+    const ScopedLock sl (lock);
+
+    // Tables only referenced by the cache are no longer used by any engine.
+    for (int i = windows.size(); --i >= 0;) {
+        WindowTable *window = windows.getObjectPointerUnchecked(i);
+        if (window->size == size && window->type == type)
+            return window;
+        if (window->getReferenceCount() == 1)
+            windows.remove(i);
+    }
+
+    WindowTable::Ptr window = new WindowTable();
+    window->data.allocate(size, false);
+    window->size = size;
+    window->type = type;
+    Windowing::fillWindowingTable(window->data, size, (Windowing::WindowType)type);
+    windows.add(window);
+    return window;
+}
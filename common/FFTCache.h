@@ -0,0 +1,57 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/** Process-wide cache of FFT plans and window tables, shared by every
+    instance through a SharedResourcePointer<FFTCache>.
+
+    Plans and tables are immutable once built, so any number of engines can
+    use them at the same time from their audio threads. Lookups lock and may
+    allocate, they must happen in prepareToPlay or on a background thread,
+    never on the audio thread. */
+class FFTCache
+{
+public:
+    enum
+    {
+        maxOrder = 16
+    };
+
+    /** A window table, kept alive by the Windowing objects using it. */
+    struct WindowTable : public ReferenceCountedObject
+    {
+        using Ptr = ReferenceCountedObjectPtr<WindowTable>;
+
+        HeapBlock<float> data;
+        int size = 0;
+        int type = 0;
+    };
+
+    FFTCache();
+    ~FFTCache();
+
+    /** Returns the plan for 1 << order points, built on first use and kept
+        for the lifetime of the cache. */
+    const dsp::FFT * getPlan(int order);
+
+    /** Returns the table of the given size and Windowing::WindowType. */
+    WindowTable::Ptr getWindow(int size, int type);
+
+private:
+    CriticalSection lock;
+    std::unique_ptr<dsp::FFT> plans[maxOrder + 1];
+    ReferenceCountedArray<WindowTable> windows;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FFTCache)
+};
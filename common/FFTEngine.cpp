@@ -11,96 +11,669 @@
 
 #include "FFTEngine.h"
 
-FFTEngine::FFTEngine() {}
+#ifndef M_PI
+#define M_PI (3.14159265358979323846264338327950288)
+#endif
 
-FFTEngine::~FFTEngine() {}
+FFTEngine::FFTEngine() : fadeSetup(nullptr), spareSetup(&setups[1]), readySetup(nullptr),
+                         requestedOrder(0), requestedOverlaps(1), requestedWintype(0),
+                         builtOrder(0), builtOverlaps(0), builtWintype(0),
+                         forwardFFT(nullptr), prepared(false), amortized(false), splitComplex(false),
+                         numQueuedFrames(0), queuedFrame(0), frameStage(0), primingStages(0), primingLength(1),
+                         numChannels(1), preparedOrder(0),
+                         ringSize(0), ringMask(0), fifoIndex(0), hopCounter(0),
+                         fadeRemaining(0), fadeLength(1), fadeGain(0.0f),
+                         fftOrder(0), fftSize(0), fftOverlaps(0), fftHopSize(0), fftWintype(0) {
+    activeSetup = &setups[0];
+}
+
+FFTEngine::~FFTEngine() {
+    builder->removeTimeSliceClient(this);
+}
+
+void FFTEngine::setAmortized(bool shouldBeAmortized) {
+    jassert (! prepared || shouldBeAmortized == amortized);
+    amortized = shouldBeAmortized;
+}
+
+void FFTEngine::setSplitComplex(bool shouldBeSplit) {
+    jassert (! prepared || shouldBeSplit == splitComplex);
+    splitComplex = shouldBeSplit;
+}
+
+void FFTEngine::prepare(int maxOrder, bool stereoLinked) {
+    // Keep the builder thread away while the setups are rebuilt.
+    builder->removeTimeSliceClient(this);
+
+    preparedOrder = jlimit((int)fftMinOrder, (int)fftMaxOrder, maxOrder);
+    for (int order = amortized ? fftMinOrder - 2 : fftMinOrder; order <= preparedOrder; order++) {
+        plans[order] = cache->getPlan(order);
+    }
+
+    // The input rings hold two frames of the largest order: a setup switch
+    // primes the new accumulator with input from up to a frame further back.
+    // Everything else belongs to the setups and follows the active order.
+    numChannels = stereoLinked ? 2 : 1;
+    ringSize = 2 << preparedOrder;
+    ringMask = ringSize - 1;
+    for (int channel = 0; channel < fftMaxChannels; channel++) {
+        inputRing[channel].allocate(channel < numChannels ? ringSize : 0, true);
+    }
+
+    builtOrder = jmin(requestedOrder.load(), preparedOrder);
+    builtOverlaps = requestedOverlaps.load();
+    builtWintype = requestedWintype.load();
+
+    activeSetup = &setups[0];
+    activeSetup->order = builtOrder;
+    activeSetup->overlaps = builtOverlaps;
+    activeSetup->wintype = builtWintype;
+    activeSetup->window.setup(1 << builtOrder, (Windowing::WindowType)builtWintype);
+    allocateSetup(*activeSetup, builtOrder);
+    releaseSetup(setups[1]);
+    fadeSetup = nullptr;
+    spareSetup.store(&setups[1]);
+    readySetup.store(nullptr);
+
+    applySetup(activeSetup);
+    prepared = true;
+    reset();
+
+    builder->addTimeSliceClient(this);
+}
 
 void FFTEngine::reset() {
     fifoIndex = 0;
-    for (int overlap = 0; overlap < fftMaxOverlaps; overlap++) {
-        zeromem(fftData[overlap], sizeof(fftData[overlap]));
-        zeromem(fifo[overlap], sizeof(fifo[overlap]));
+    hopCounter = 0;
+    fadeRemaining = 0;
+    numQueuedFrames = queuedFrame = frameStage = 0;
+    primingStages = 0;
+    if (! prepared)
+        return;
+
+    if (fadeSetup != nullptr) {
+        spareSetup.store(fadeSetup);
+        fadeSetup = nullptr;
+    }
+    for (int channel = 0; channel < numChannels; channel++) {
+        FloatVectorOperations::clear(inputRing[channel], ringSize);
+        FloatVectorOperations::clear(activeSetup->outputAccum[channel], 2 << fftOrder);
+        FloatVectorOperations::clear(activeSetup->fftData[channel], 2 << fftOrder);
     }
-    forwardFFT.reset( new dsp::FFT(fftOrder));
-    window.setup(fftSize, (Windowing::WindowType)fftWintype);
 }
 
 void FFTEngine::setOrder(int order) {
-    if (order == fftOrder)
-        return;
-
-    fftOrder = order <= fftMaxOrder ? order : fftMaxOrder;
-    fftSize = 1 << fftOrder;
-    fftHopSize = fftSize / fftOverlaps;
-    reset();
+    setup(order, requestedOverlaps.load(), requestedWintype.load());
 }
 
 void FFTEngine::setOverlaps(int overlaps) {
-    if (overlaps == fftOverlaps)
-        return;
-
-    fftOverlaps = overlaps <= fftMaxOverlaps ? overlaps : fftMaxOverlaps;
-    fftHopSize = fftSize / fftOverlaps; 
-    reset();
+    setup(requestedOrder.load(), overlaps, requestedWintype.load());
 }
 
 void FFTEngine::setWintype(int type) {
-    fftWintype = type;
-    window.setup(fftSize, (Windowing::WindowType)fftWintype);
+    setup(requestedOrder.load(), requestedOverlaps.load(), type);
 }
 
 int FFTEngine::getSize() {
     return fftSize;
 }
 
+int FFTEngine::getHopSize() {
+    return fftHopSize;
+}
+
+int FFTEngine::getNumChannels() {
+    return numChannels;
+}
+
+int FFTEngine::getLatencyInSamples() {
+    return amortized ? fftSize + fftHopSize : fftSize;
+}
+
 void FFTEngine::setup(int order, int overlaps, int wintype) {
-    if (order == fftOrder && overlaps == fftOverlaps && wintype == fftWintype)
-        return;
+    // Only records the request, the builder thread prepares the window table
+    // and the audio thread switches to it at the next hop boundary.
+    requestedOrder.store(jlimit((int)fftMinOrder, (int)fftMaxOrder, order));
+    requestedOverlaps.store(jlimit(1, (int)fftMaxOverlaps, overlaps));
+    requestedWintype.store(wintype);
+
+    if (! prepared) {
+        fftOrder = requestedOrder.load();
+        fftSize = 1 << fftOrder;
+        fftOverlaps = requestedOverlaps.load();
+        fftHopSize = fftSize / fftOverlaps;
+        fftWintype = wintype;
+    }
+}
+
+int FFTEngine::useTimeSlice() {
+    int order = jmin(requestedOrder.load(), preparedOrder);
+    int overlaps = requestedOverlaps.load();
+    int wintype = requestedWintype.load();
+
+    if (order == builtOrder && overlaps == builtOverlaps && wintype == builtWintype) {
+        // A setup handed back after its fade keeps its buffers until here.
+        Setup *spare = spareSetup.exchange(nullptr);
+        if (spare != nullptr) {
+            releaseSetup(*spare);
+            spareSetup.store(spare);
+        }
+        return 10;
+    }
+
+    Setup *newSetup = spareSetup.exchange(nullptr);
+    if (newSetup == nullptr)
+        return 10;  // The previous setup has not been faded out yet.
+
+    newSetup->order = order;
+    newSetup->overlaps = overlaps;
+    newSetup->wintype = wintype;
+    newSetup->window.setup(1 << order, (Windowing::WindowType)wintype);
+    allocateSetup(*newSetup, builtOrder);
+    builtOrder = order;
+    builtOverlaps = overlaps;
+    builtWintype = wintype;
+
+    readySetup.store(newSetup);
+    return 10;
+}
+
+void FFTEngine::allocateSetup(Setup &setup, int previousOrder) {
+    int size = 1 << setup.order;
+    int overlaps = jmin(setup.overlaps, size);
+    int hopSize = size / overlaps;
+    for (int channel = 0; channel < fftMaxChannels; channel++) {
+        int numBins = channel < numChannels && splitComplex ? size / 2 + 1 : 0;
+        setup.outputAccum[channel].allocate(channel < numChannels ? 2 * size : 0, true);
+        setup.fftData[channel].allocate(channel < numChannels ? 2 * size : 0, true);
+        setup.splitReal[channel].allocate(numBins, true);
+        setup.splitImag[channel].allocate(numBins, true);
+    }
+
+    bool useComplexTransforms = numChannels == 2 || amortized;
+    setup.packedData.allocate(useComplexTransforms ? size : 0, true);
+    setup.packedSpectrum.allocate(useComplexTransforms ? size : 0, true);
+    setup.subInput.allocate(amortized ? size / 4 : 0, true);
+    setup.subSpectra.allocate(amortized ? size : 0, true);
+    setup.twiddles.allocate(amortized ? size : 0, true);
+    if (amortized) {
+        for (int i = 0; i < size; i++) {
+            setup.twiddles[i] = std::polar (1.0f, (float)(-2.0 * M_PI * i / size));
+        }
+    }
+
+    setup.coverageSize = 2 << jmax(setup.order, previousOrder);
+    setup.coverage.allocate(setup.coverageSize, true);
 
-    fftOrder = order <= fftMaxOrder ? order : fftMaxOrder;
+    // Steady window power, by position in the hop.
+    const float *window = setup.window.getWindowingTable();
+    setup.target.allocate(hopSize, true);
+    for (int i = 0; i < hopSize; i++) {
+        float power = 0.0f;
+        for (int j = i; j < size; j += hopSize) {
+            float w = window != nullptr ? window[j] : 1.0f;
+            power += w * w / overlaps;
+        }
+        setup.target[i] = power;
+    }
+}
+
+void FFTEngine::releaseSetup(Setup &setup) {
+    for (int channel = 0; channel < fftMaxChannels; channel++) {
+        setup.outputAccum[channel].free();
+        setup.fftData[channel].free();
+        setup.splitReal[channel].free();
+        setup.splitImag[channel].free();
+    }
+    setup.packedData.free();
+    setup.packedSpectrum.free();
+    setup.subInput.free();
+    setup.subSpectra.free();
+    setup.twiddles.free();
+    setup.coverage.free();
+    setup.coverageSize = 0;
+    setup.target.free();
+}
+
+void FFTEngine::applySetup(Setup *newSetup) {
+    fftOrder = newSetup->order;
     fftSize = 1 << fftOrder;
-    fftOverlaps = overlaps <= fftMaxOverlaps ? overlaps : fftMaxOverlaps;
-    fftHopSize = fftSize / fftOverlaps; 
-    fftWintype = wintype;
-    reset();
+    fftOverlaps = jmin(newSetup->overlaps, fftSize);
+    fftHopSize = fftSize / fftOverlaps;
+    fftWintype = newSetup->wintype;
+    forwardFFT = plans[fftOrder];
 }
 
-void FFTEngine::computeFrame(int overlap) {
-    zeromem (fftData[overlap], sizeof (fftData[overlap]));
-    memcpy (fftData[overlap], fifo[overlap], sizeof (fifo[overlap]));
-    window.multiplyWithWindowingTable (fftData[overlap], fftSize);
-    forwardFFT->performRealOnlyForwardTransform (fftData[overlap], true);
+void FFTEngine::packChannels() {
+    Setup &setup = *activeSetup;
+    const float *left = setup.fftData[0];
+    const float *right = numChannels == 2 ? setup.fftData[1].getData() : nullptr;
+    for (int i = 0; i < fftSize; i++) {
+        setup.packedData[i] = dsp::Complex<float> (left[i], right != nullptr ? right[i] : 0.0f);
+    }
+}
 
-    // Registered callback to process the FFT frame.
-    listeners.call([&] (Listener& l) { l.fftEngineFrameReady(this, fftData[overlap], fftSize); });
+void FFTEngine::unpackSpectra() {
+    // Z[k] = L[k] + i R[k], and both L and R are hermitian, so
+    // L[k] = (Z[k] + conj(Z[N-k])) / 2 and R[k] = (Z[k] - conj(Z[N-k])) / 2i.
+    const dsp::Complex<float> minusHalfI (0.0f, -0.5f);
+    Setup &setup = *activeSetup;
+    float *left = setup.fftData[0];
+    float *right = numChannels == 2 ? setup.fftData[1].getData() : nullptr;
+    for (int k = 0; k <= fftSize / 2; k++) {
+        dsp::Complex<float> z = setup.packedSpectrum[k];
+        dsp::Complex<float> zc = std::conj (setup.packedSpectrum[(fftSize - k) & (fftSize - 1)]);
+        dsp::Complex<float> l = (z + zc) * 0.5f;
+        left[k*2] = l.real();
+        left[k*2+1] = l.imag();
+        if (right != nullptr) {
+            dsp::Complex<float> r = (z - zc) * minusHalfI;
+            right[k*2] = r.real();
+            right[k*2+1] = r.imag();
+        }
+    }
+}
 
-    forwardFFT->performRealOnlyInverseTransform (fftData[overlap]);
-    window.multiplyWithWindowingTable (fftData[overlap], fftSize);
+void FFTEngine::notifyFrameReady() {
+    // Registered callbacks to process the FFT frames, one per channel.
+    Setup &setup = *activeSetup;
+    int numBins = fftSize / 2 + 1;
+    for (int channel = 0; channel < numChannels; channel++) {
+        float *data = setup.fftData[channel];
+        if (splitComplex) {
+            float *real = setup.splitReal[channel];
+            float *imag = setup.splitImag[channel];
+            for (int k = 0; k < numBins; k++) {
+                real[k] = data[k*2];
+                imag[k] = data[k*2+1];
+            }
+            listeners.call([&] (Listener& l) { l.fftEngineSplitFrameReady(this, channel, real, imag, fftSize); });
+            for (int k = 0; k < numBins; k++) {
+                data[k*2] = real[k];
+                data[k*2+1] = imag[k];
+            }
+        } else {
+            listeners.call([&] (Listener& l) { l.fftEngineChannelFrameReady(this, channel, data, fftSize); });
+        }
+    }
 }
 
-float FFTEngine::process(float input) {
-    if (fifoIndex % fftHopSize == 0) {
-        computeFrame(fifoIndex / fftHopSize);
+void FFTEngine::repackSpectra() {
+    // Pack the processed half spectra back, rebuilding the negative frequencies.
+    Setup &setup = *activeSetup;
+    const float *left = setup.fftData[0];
+    const float *right = numChannels == 2 ? setup.fftData[1].getData() : nullptr;
+    dsp::Complex<float> *packedSpectrum = setup.packedSpectrum;
+    int half = fftSize / 2;
+    for (int k = 0; k <= half; k++) {
+        dsp::Complex<float> l (left[k*2], left[k*2+1]);
+        dsp::Complex<float> r = right != nullptr ? dsp::Complex<float> (right[k*2], right[k*2+1]) : dsp::Complex<float> (0.0f, 0.0f);
+        packedSpectrum[k] = dsp::Complex<float> (l.real() - r.imag(), l.imag() + r.real());
+        if (k > 0 && k < half) {
+            packedSpectrum[fftSize - k] = dsp::Complex<float> (l.real() + r.imag(), r.real() - l.imag());
+        }
     }
+}
 
-    for (int overlap = 0; overlap < fftOverlaps; overlap++) {
-        int fifoIndexOverlap = (fifoIndex - fftHopSize * overlap);
-        fifoIndexOverlap = fifoIndexOverlap < 0 ? fifoIndexOverlap + fftSize : fifoIndexOverlap; 
-        fifo[overlap][fifoIndexOverlap] = input;
+void FFTEngine::unpackChannels() {
+    Setup &setup = *activeSetup;
+    float *left = setup.fftData[0];
+    float *right = numChannels == 2 ? setup.fftData[1].getData() : nullptr;
+    for (int i = 0; i < fftSize; i++) {
+        left[i] = setup.packedData[i].real();
+        if (right != nullptr)
+            right[i] = setup.packedData[i].imag();
     }
+}
 
-    float outputSignal = 0.0f;
-    for (int overlap = 0; overlap < fftOverlaps; overlap++) {
-        int fifoIndexOverlap = (fifoIndex - fftHopSize * overlap);
-        fifoIndexOverlap = fifoIndexOverlap < 0 ? fifoIndexOverlap + fftSize : fifoIndexOverlap; 
-        outputSignal += fftData[overlap][fifoIndexOverlap];
+void FFTEngine::transformStereoFrame() {
+    Setup &setup = *activeSetup;
+    packChannels();
+    forwardFFT->perform (setup.packedData, setup.packedSpectrum, false);
+    unpackSpectra();
+    notifyFrameReady();
+    repackSpectra();
+    forwardFFT->perform (setup.packedSpectrum, setup.packedData, true);
+    unpackChannels();
+}
+
+void FFTEngine::overlapAdd(int position, int offset) {
+    // Adds the windowed frame from offset on, starting at the given position
+    // of the input ring, which is larger than the accumulators.
+    Setup &setup = *activeSetup;
+    int accumSize = 2 << fftOrder;
+    int start = position & (accumSize - 1);
+    int length = fftSize - offset;
+    int tail = jmin(length, accumSize - start);
+    for (int channel = 0; channel < numChannels; channel++) {
+        float *data = setup.fftData[channel];
+        setup.window.multiplyWithWindowingTable (data, fftSize);
+        FloatVectorOperations::add (setup.outputAccum[channel] + start, data + offset, tail);
+        FloatVectorOperations::add (setup.outputAccum[channel], data + offset + tail, length - tail);
+    }
+
+    if (fadeRemaining > 0) {
+        addWindowPower(setup.window.getWindowingTable(), fftSize, fftOverlaps, position, offset);
+    }
+}
+
+void FFTEngine::addWindowPower(const float *window, int size, int overlaps, int position, int offset) {
+    // The window is applied before and after the transforms, so a frame
+    // weights the output by its squared window.
+    float *coverage = activeSetup->coverage;
+    int coverageMask = activeSetup->coverageSize - 1;
+    for (int i = offset; i < size; i++) {
+        float w = window != nullptr ? window[i] : 1.0f;
+        coverage[(position + i - offset) & coverageMask] += w * w / overlaps;
+    }
+}
+
+void FFTEngine::switchSetup(Setup *newSetup) {
+    // The old accumulator drains over the old fftSize, mixed with the new
+    // one in proportion to the window power each holds at every sample.
+    // The new setup comes with cleared buffers.
+    const float *oldWindow = activeSetup->window.getWindowingTable();
+    int oldSize = fftSize;
+    int oldOverlaps = fftOverlaps;
+    int oldHopSize = fftHopSize;
+    fadeSetup = activeSetup;
+    activeSetup = newSetup;
+    applySetup(activeSetup);
+
+    // In amortized mode, the frame just finished lands here, otherwise the
+    // last old frame landed a hop ago.
+    for (int frame = amortized ? 0 : 1; frame < oldOverlaps; frame++) {
+        addWindowPower(oldWindow, oldSize, oldOverlaps, fifoIndex, frame * oldHopSize);
+    }
+    fadeGain = 1.0f / oldOverlaps;
+    fadeLength = fadeRemaining = oldSize;
+
+    // Listeners resize their state before the first frame of the new setup.
+    listeners.call([&] (Listener& l) { l.fftEngineSetupChanged(this); });
+
+    // Primes the new accumulator with the frames of the new setup that
+    // would still overlap here, taken from the input ring, so that it
+    // starts at its steady level. The oldest frame goes first, listeners
+    // see the frames in time order. In amortized mode, frames land a hop
+    // after their last input sample.
+    int delay = amortized ? fftHopSize : 0;
+    int numFrames = (fftSize + delay - 1) / fftHopSize;
+    for (int frame = numFrames; frame >= 1; frame--) {
+        int end = (fifoIndex - frame * fftHopSize) & ringMask;
+        if (amortized) {
+            queueFrame(end, fifoIndex, frame * fftHopSize - delay, true);
+        } else {
+            transformFrame(end, fifoIndex, frame * fftHopSize - delay);
+        }
+    }
+
+    // In amortized mode, the primed frames run in stages ahead of the
+    // regular one, and are done while the old frames still cover the
+    // output. The fade lasts until they have all been added.
+    if (amortized) {
+        primingStages = numFrames * numFrameStages;
+        primingLength = jlimit(1, fftHopSize, oldSize);
+        fadeLength = fadeRemaining = jmax(oldSize, fftHopSize);
+    }
+}
+
+void FFTEngine::computeFrame() {
+    transformFrame(fifoIndex, fifoIndex, 0);
+}
+
+void FFTEngine::transformFrame(int end, int position, int offset) {
+    // The fftSize input samples before end, unrolled in time order.
+    Setup &setup = *activeSetup;
+    int start = (end - fftSize) & ringMask;
+    int tail = jmin(fftSize, ringSize - start);
+    for (int channel = 0; channel < numChannels; channel++) {
+        float *data = setup.fftData[channel];
+        FloatVectorOperations::copy (data, inputRing[channel] + start, tail);
+        FloatVectorOperations::copy (data + tail, inputRing[channel], fftSize - tail);
+        FloatVectorOperations::clear (data + fftSize, fftSize);
+        setup.window.multiplyWithWindowingTable (data, fftSize);
+    }
+
+    if (numChannels == 2) {
+        transformStereoFrame();
+    } else {
+        forwardFFT->performRealOnlyForwardTransform (setup.fftData[0], true);
+        notifyFrameReady();
+        forwardFFT->performRealOnlyInverseTransform (setup.fftData[0]);
+    }
+
+    overlapAdd(position, offset);
+}
+
+void FFTEngine::performSubTransform(const dsp::Complex<float> *input, int part) {
+    // Decimation in time, sub-transform of every fourth sample from part.
+    Setup &setup = *activeSetup;
+    int quarter = fftSize / 4;
+    for (int j = 0; j < quarter; j++) {
+        setup.subInput[j] = input[4 * j + part];
+    }
+    plans[fftOrder - 2]->perform (setup.subInput, setup.subSpectra + part * quarter, false);
+}
+
+void FFTEngine::combineSubTransforms(dsp::Complex<float> *output) {
+    // Radix-4 butterflies merging the four quarter-size spectra.
+    const dsp::Complex<float> minusI (0.0f, -1.0f);
+    const dsp::Complex<float> *subSpectra = activeSetup->subSpectra;
+    const dsp::Complex<float> *twiddles = activeSetup->twiddles;
+    int quarter = fftSize / 4;
+    for (int k = 0; k < quarter; k++) {
+        dsp::Complex<float> y0 = subSpectra[k];
+        dsp::Complex<float> y1 = subSpectra[quarter + k] * twiddles[k];
+        dsp::Complex<float> y2 = subSpectra[2 * quarter + k] * twiddles[2 * k];
+        dsp::Complex<float> y3 = subSpectra[3 * quarter + k] * twiddles[3 * k];
+        dsp::Complex<float> a = y0 + y2, b = y0 - y2, c = y1 + y3, d = (y1 - y3) * minusI;
+        output[k] = a + c;
+        output[k + quarter] = b + d;
+        output[k + 2 * quarter] = a - c;
+        output[k + 3 * quarter] = b - d;
+    }
+}
+
+void FFTEngine::queueFrame(int end, int position, int offset, bool late) {
+    QueuedFrame &frame = frameQueue[numQueuedFrames++];
+    frame.end = end;
+    frame.position = position;
+    frame.offset = offset;
+    frame.late = late;
+}
+
+void FFTEngine::runFrameStage() {
+    const QueuedFrame &frame = frameQueue[queuedFrame];
+    Setup &setup = *activeSetup;
+    switch (frameStage) {
+        case 0: {
+            // A windowed snapshot of the input, which keeps being
+            // overwritten while the other stages run.
+            int start = (frame.end - fftSize) & ringMask;
+            int tail = jmin(fftSize, ringSize - start);
+            for (int channel = 0; channel < numChannels; channel++) {
+                float *data = setup.fftData[channel];
+                FloatVectorOperations::copy (data, inputRing[channel] + start, tail);
+                FloatVectorOperations::copy (data + tail, inputRing[channel], fftSize - tail);
+                setup.window.multiplyWithWindowingTable (data, fftSize);
+            }
+            packChannels();
+            break;
+        }
+        case 1: case 2: case 3: case 4:
+            performSubTransform(setup.packedData, frameStage - 1);
+            break;
+        case 5:
+            combineSubTransforms(setup.packedSpectrum);
+            break;
+        case 6:
+            unpackSpectra();
+            notifyFrameReady();
+            repackSpectra();
+            // The inverse transform is a forward one on the conjugate.
+            for (int i = 0; i < fftSize; i++) {
+                setup.packedData[i] = std::conj (setup.packedSpectrum[i]);
+            }
+            break;
+        case 7: case 8: case 9: case 10:
+            performSubTransform(setup.packedData, frameStage - 7);
+            break;
+        case 11: {
+            combineSubTransforms(setup.packedSpectrum);
+            float scale = 1.0f / fftSize;
+            for (int i = 0; i < fftSize; i++) {
+                setup.packedData[i] = std::conj (setup.packedSpectrum[i]) * scale;
+            }
+            unpackChannels();
+            int position = frame.position;
+            int offset = frame.offset;
+            if (frame.late) {
+                int elapsed = (fifoIndex - position) & ringMask;
+                position = fifoIndex;
+                offset += elapsed;
+            }
+            if (offset < fftSize) {
+                overlapAdd(position, offset);
+            }
+            break;
+        }
+        default:
+            jassertfalse;
+            break;
     }
-    outputSignal /= fftOverlaps;
 
-    fifoIndex++;
-    if (fifoIndex == fftSize) {
-        fifoIndex = 0;
+    if (++frameStage == numFrameStages) {
+        frameStage = 0;
+        queuedFrame++;
+    }
+}
+
+void FFTEngine::advanceFrame() {
+    // Runs the stages due at this point of the hop, the primed frames
+    // first, over primingLength samples.
+    int elapsed = fftHopSize - hopCounter;
+    int dueStage = numFrameStages * elapsed / fftHopSize;
+    if (primingStages > 0) {
+        dueStage += primingStages * jmin(elapsed, primingLength) / primingLength;
+    }
+    dueStage = jmin(dueStage, numQueuedFrames * (int)numFrameStages);
+    while (queuedFrame * numFrameStages + frameStage < dueStage) {
+        runFrameStage();
+    }
+}
+
+void FFTEngine::finishFrames() {
+    while (queuedFrame < numQueuedFrames) {
+        runFrameStage();
+    }
+    numQueuedFrames = queuedFrame = 0;
+    primingStages = 0;
+}
+
+float FFTEngine::process(float input) {
+    float output;
+    processBlock(&input, &output, 1);
+    return output;
+}
+
+void FFTEngine::processSpan(const float **inputs, float **outputs, int offset, int span) {
+    // The accumulators are smaller than the input ring and the span never
+    // crosses the end of any of them.
+    Setup &setup = *activeSetup;
+    int accumIndex = fifoIndex & ((2 << fftOrder) - 1);
+    for (int channel = 0; channel < numChannels; channel++) {
+        const float *input = inputs[channel] + offset;
+        float *output = outputs[channel] + offset;
+        float *accum = setup.outputAccum[channel] + accumIndex;
+
+        FloatVectorOperations::copy(inputRing[channel] + fifoIndex, input, span);
+        FloatVectorOperations::multiply(output, accum, 1.0f / fftOverlaps, span);
+        FloatVectorOperations::clear(accum, span);
+
+        if (fadeRemaining > 0) {
+            // Sum of both setups, brought back to the steady window power.
+            // The old accumulator is drained too, the fade can outlast it.
+            float *fadeAccum = fadeSetup->outputAccum[channel] + (fifoIndex & ((2 << fadeSetup->order) - 1));
+            const float *coverage = setup.coverage + (fifoIndex & (setup.coverageSize - 1));
+            int numFaded = jmin(span, fadeRemaining);
+            int elapsed = fadeLength - fadeRemaining;
+            for (int i = 0; i < numFaded; i++) {
+                float target = setup.target[(elapsed + i) % fftHopSize];
+                float gain = coverage[i] > 0.0f ? target / coverage[i] : 0.0f;
+                output[i] = (output[i] + fadeAccum[i] * fadeGain) * gain;
+            }
+            FloatVectorOperations::clear(fadeAccum, numFaded);
+        }
     }
 
-    return outputSignal;
+    fadeRemaining = jmax(0, fadeRemaining - span);
+    fifoIndex = (fifoIndex + span) & ringMask;
+}
+
+void FFTEngine::processBlock(const float *input, float *output, int numSamples) {
+    jassert (numChannels == 1);
+    processChannels(&input, &output, numSamples);
+}
+
+void FFTEngine::processBlock(const float *inputLeft, const float *inputRight,
+                             float *outputLeft, float *outputRight, int numSamples) {
+    jassert (numChannels == 2);
+    const float *inputs[2] = { inputLeft, inputRight };
+    float *outputs[2] = { outputLeft, outputRight };
+    processChannels(inputs, outputs, numSamples);
+}
+
+void FFTEngine::processChannels(const float **inputs, float **outputs, int numSamples) {
+    if (! prepared) {
+        for (int channel = 0; channel < numChannels; channel++) {
+            FloatVectorOperations::clear(outputs[channel], numSamples);
+        }
+        return;
+    }
+
+    int done = 0;
+    while (done < numSamples) {
+        if (hopCounter == 0) {
+            // In amortized mode, the frames started one hop ago must be
+            // added before their first sample is read.
+            if (amortized) {
+                finishFrames();
+            }
+
+            // A new setup waits for the end of the previous switch.
+            Setup *newSetup = fadeRemaining == 0 ? readySetup.exchange(nullptr) : nullptr;
+            if (newSetup != nullptr) {
+                switchSetup(newSetup);
+            }
+
+            if (amortized) {
+                // The snapshot of the first frame is taken now, the oldest
+                // primed one starts a ring size before the write position.
+                queueFrame(fifoIndex, (fifoIndex + fftHopSize) & ringMask, 0, false);
+                runFrameStage();
+            } else {
+                computeFrame();
+            }
+            hopCounter = fftHopSize;
+        }
+
+        // Number of samples until the next hop boundary or the end of the
+        // smallest ring in use.
+        int wrap = 2 << (fadeSetup != nullptr ? jmin(fftOrder, fadeSetup->order) : fftOrder);
+        int span = jmin(hopCounter, numSamples - done, wrap - (fifoIndex & (wrap - 1)));
+        processSpan(inputs, outputs, done, span);
+
+        done += span;
+        hopCounter -= span;
+
+        // The old setup goes back to the builder once faded out.
+        if (fadeSetup != nullptr && fadeRemaining == 0) {
+            spareSetup.store(fadeSetup);
+            fadeSetup = nullptr;
+        }
+
+        if (amortized) {
+            advanceFrame();
+        }
+    }
 }
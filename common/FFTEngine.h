@@ -13,27 +13,83 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "Windowing.h"
+#include "FFTCache.h"
 
-class FFTEngine 
+/** Background thread, shared by all engines, where window tables are built. */
+class FFTEngineBuilder : public TimeSliceThread
+{
+public:
+    FFTEngineBuilder() : TimeSliceThread("FFTEngine builder") { startThread(3); }
+    ~FFTEngineBuilder() { stopThread(1000); }
+};
+
+class FFTEngine : private TimeSliceClient
 {
 public:
     FFTEngine();
     ~FFTEngine();
+
+    /** Builds every FFT plan up to maxOrder and allocates the buffers.
+        Must be called from prepareToPlay, never from the audio thread.
+
+        In stereo-linked mode, left and right channels are packed as the real
+        and imaginary parts of a single complex FFT, so a stereo frame costs
+        one forward and one inverse transform. Listeners still receive one
+        half spectrum per channel. */
+    void prepare(int maxOrder = fftMaxOrder, bool stereoLinked = false);
+
+    /** In amortized mode, each frame is split in stages (windowing, four
+        quarter-size sub-transforms and a radix-4 pass for each direction,
+        the listener callbacks, overlap-add) that are spread over the next
+        hop, so that no single block carries a whole frame. After a setup
+        switch, the frames primed for the new setup are staged the same way,
+        ahead of the regular one. This delays the output by one more hop.
+        Must be called before prepare(). */
+    void setAmortized(bool shouldBeAmortized);
+
+    /** In split mode, listeners receive each half spectrum as two contiguous
+        arrays of fftSize / 2 + 1 real and imaginary parts, through
+        fftEngineSplitFrameReady, instead of interleaved pairs. Bin loops
+        then run on unit-stride data, see SpectralOps for vectorized
+        helpers. Must be called before prepare(). */
+    void setSplitComplex(bool shouldBeSplit);
+
+    /** Latency of the current setup, in samples. */
+    int getLatencyInSamples();
+
     void reset();
     void setup(int order, int overlaps, int wintype);
-    void computeFrame(int overlap);
+    void computeFrame();
     float process(float input);
 
+    /** Processes a block of samples, in and out may point to the same buffer. */
+    void processBlock(const float *input, float *output, int numSamples);
+
+    /** Processes a block of stereo samples, the engine must be stereo-linked. */
+    void processBlock(const float *inputLeft, const float *inputRight,
+                      float *outputLeft, float *outputRight, int numSamples);
+
     void setOrder(int order);
     void setOverlaps(int overlaps);
     void setWintype(int type);
 
     int getSize();
+    int getHopSize();
+    int getNumChannels();
 
     struct Listener
     {
         virtual ~Listener() {}
-        virtual void fftEngineFrameReady(FFTEngine *engine, float *fftData, int fftSize) = 0;
+        virtual void fftEngineFrameReady(FFTEngine *engine, float *fftData, int fftSize) {}
+        /** Same as above, with the channel index for stereo-linked engines. */
+        virtual void fftEngineChannelFrameReady(FFTEngine *engine, int channel, float *fftData, int fftSize) {
+            fftEngineFrameReady(engine, fftData, fftSize);
+        }
+        /** Split mode only, real and imag hold fftSize / 2 + 1 bins each. */
+        virtual void fftEngineSplitFrameReady(FFTEngine *engine, int channel, float *real, float *imag, int fftSize) {}
+        /** Called on the audio thread when a new order/overlaps/wintype becomes
+            active, before the first frame of the new setup. */
+        virtual void fftEngineSetupChanged(FFTEngine *engine) {}
     };
 
     void addListener(Listener* l) { listeners.add (l); }
@@ -44,18 +100,137 @@ private:
 
     enum
     {
+        fftMinOrder = 4,
         fftMaxOrder = 14,
         fftMaxSize = 1 << fftMaxOrder,
-        fftMaxOverlaps = 8
+        fftMaxOverlaps = 8,
+        fftMaxChannels = 2,
+        numFrameStages = 12
     };
 
-    Windowing window;
+    // A window table along with the parameters it was built for, and the
+    // buffers sized to them, allocated and cleared by the builder thread.
+    struct Setup
+    {
+        Windowing window;
+        int order = 0;
+        int overlaps = 0;
+        int wintype = 0;
+        // Circular overlap-add accumulators, read and cleared one sample at
+        // a time. They hold two frames, in amortized mode a frame is added
+        // one hop after the current read position.
+        HeapBlock<float> outputAccum[fftMaxChannels];
+        // Summed window power of the frames present in both accumulators
+        // during a switch to this setup (as large as the larger of the two),
+        // and the steady window power over one hop.
+        HeapBlock<float> coverage;
+        int coverageSize = 0;
+        HeapBlock<float> target;
+        // Working frames for the real-only transforms (needs 2 * fftSize floats).
+        HeapBlock<float> fftData[fftMaxChannels];
+        // Packed left + i * right signal and its spectrum, used by the complex
+        // transforms of the stereo-linked and amortized modes.
+        HeapBlock<dsp::Complex<float>> packedData;
+        HeapBlock<dsp::Complex<float>> packedSpectrum;
+        // Amortized mode only: sub-transform scratch, their spectra and the
+        // twiddle factors.
+        HeapBlock<dsp::Complex<float>> subInput;
+        HeapBlock<dsp::Complex<float>> subSpectra;
+        HeapBlock<dsp::Complex<float>> twiddles;
+        // Split mode only: deinterleaved half spectra handed to the listeners.
+        HeapBlock<float> splitReal[fftMaxChannels];
+        HeapBlock<float> splitImag[fftMaxChannels];
+    };
+
+    // A frame waiting in the amortized scheduler: the fftSize input samples
+    // before end, added from offset on at position. A late frame, primed
+    // after a switch, drops the samples the output has already read.
+    struct QueuedFrame
+    {
+        int end;
+        int position;
+        int offset;
+        bool late;
+    };
+
+    int useTimeSlice() override;
+    void allocateSetup(Setup &setup, int previousOrder);
+    void releaseSetup(Setup &setup);
+    void applySetup(Setup *newSetup);
+    void processChannels(const float **inputs, float **outputs, int numSamples);
+    void processSpan(const float **inputs, float **outputs, int offset, int span);
+    void transformStereoFrame();
+    void packChannels();
+    void unpackSpectra();
+    void notifyFrameReady();
+    void repackSpectra();
+    void unpackChannels();
+    void transformFrame(int end, int position, int offset);
+    void overlapAdd(int position, int offset);
+    void switchSetup(Setup *newSetup);
+    void addWindowPower(const float *window, int size, int overlaps, int position, int offset);
+    void performSubTransform(const dsp::Complex<float> *input, int part);
+    void combineSubTransforms(dsp::Complex<float> *output);
+    void queueFrame(int end, int position, int offset, bool late);
+    void runFrameStage();
+    void advanceFrame();
+    void finishFrames();
 
-    std::unique_ptr<dsp::FFT> forwardFFT;
+    SharedResourcePointer<FFTEngineBuilder> builder;
+    SharedResourcePointer<FFTCache> cache;
 
-    float fifo[fftMaxOverlaps][fftMaxSize];
-    float fftData[fftMaxOverlaps][2 * fftMaxSize];
+    // The audio thread owns activeSetup. The builder thread takes spareSetup,
+    // fills it with the requested parameters and hands it back through
+    // readySetup. Both hand-overs are a single atomic pointer exchange.
+    // After a switch, the previous setup is faded out and only then handed
+    // back as the spare, whose buffers the builder releases.
+    Setup setups[2];
+    Setup *activeSetup;
+    Setup *fadeSetup;
+    std::atomic<Setup*> spareSetup;
+    std::atomic<Setup*> readySetup;
+
+    std::atomic<int> requestedOrder;
+    std::atomic<int> requestedOverlaps;
+    std::atomic<int> requestedWintype;
+
+    // Parameters of the last setup built, only touched by the builder thread.
+    int builtOrder;
+    int builtOverlaps;
+    int builtWintype;
+
+    // Plans borrowed from the cache, from order 2 for the quarter-size
+    // transforms of the amortized mode.
+    const dsp::FFT *plans[fftMaxOrder + 1] = {};
+    const dsp::FFT *forwardFFT;
+
+    // Circular buffers holding the last input samples. They keep the
+    // prepared size, two frames of the largest order, so that a switch to
+    // any order finds the input of the frames it primes.
+    HeapBlock<float> inputRing[fftMaxChannels];
+
+    bool prepared;
+    bool amortized;
+    bool splitComplex;
+    // Amortized mode only: frames of the current hop, run one after the
+    // other. After a switch, the primed frames come first and their stages
+    // are spread over primingLength samples.
+    QueuedFrame frameQueue[fftMaxOverlaps + 1];
+    int numQueuedFrames;
+    int queuedFrame;
+    int frameStage;
+    int primingStages;
+    int primingLength;
+    int numChannels;
+    int preparedOrder;
+    int ringSize;
+    int ringMask;
     int fifoIndex;
+    int hopCounter;
+    int fadeRemaining;
+    int fadeLength;
+    float fadeGain;
+
     int fftOrder;
     int fftSize;
     int fftOverlaps;
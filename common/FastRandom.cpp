@@ -0,0 +1,132 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <stdlib.h>
+#include "FastRandom.h"
+
+namespace {
+    std::atomic<uint64_t> instanceCounter(0);
+    std::atomic<bool> useFixedSeed(false);
+    std::atomic<uint64_t> fixedSeed(0);
+
+    // Offline renders can ask for a fixed seed without touching the plugins.
+    struct EnvironmentSeed {
+        EnvironmentSeed() {
+            if (const char *value = getenv("PLUGEX_RANDOM_SEED")) {
+                fixedSeed = strtoull(value, nullptr, 10);
+                useFixedSeed = true;
+            }
+        }
+    };
+    const EnvironmentSeed environmentSeed;
+
+    // splitmix64, spreads any seed over the whole state.
+    uint64_t splitMix(uint64_t &x) {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    inline uint32_t rotl(uint32_t x, int k) {
+        return (x << k) | (x >> (32 - k));
+    }
+}
+
+FastRandom::FastRandom() {
+    instanceNumber = instanceCounter++;
+    reseed();
+}
+
+FastRandom::~FastRandom() {}
+
+void FastRandom::reseed(uint64_t salt) {
+    if (useFixedSeed) {
+        setSeed(fixedSeed ^ (salt * 0xD1B54A32D192ED03ULL));
+    } else {
+        // Instances seeded at the same time still get different sequences.
+        uint64_t seed = static_cast<uint64_t> (std::chrono::high_resolution_clock::now().time_since_epoch().count());
+        setSeed(seed ^ (instanceNumber * 0xD1B54A32D192ED03ULL));
+    }
+}
+
+void FastRandom::setSeed(uint64_t newSeed) {
+    uint64_t x = newSeed;
+    for (int k = 0; k < 4; k += 2) {
+        uint64_t z = splitMix(x);
+        state[k] = static_cast<uint32_t> (z);
+        state[k + 1] = static_cast<uint32_t> (z >> 32);
+    }
+    for (int l = 0; l < 4; l++) {
+        for (int k = 0; k < 4; k += 2) {
+            uint64_t z = splitMix(x);
+            lanes[k][l] = static_cast<uint32_t> (z);
+            lanes[k + 1][l] = static_cast<uint32_t> (z >> 32);
+        }
+    }
+}
+
+void FastRandom::fillUniform(float *destination, int numSamples) {
+    uint32_t s0[4], s1[4], s2[4], s3[4];
+    for (int l = 0; l < 4; l++) {
+        s0[l] = lanes[0][l]; s1[l] = lanes[1][l]; s2[l] = lanes[2][l]; s3[l] = lanes[3][l];
+    }
+
+    int i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        for (int l = 0; l < 4; l++) {
+            const uint32_t result = s0[l] + s3[l];
+            const uint32_t t = s1[l] << 9;
+            s2[l] ^= s0[l];
+            s3[l] ^= s1[l];
+            s1[l] ^= s2[l];
+            s0[l] ^= s3[l];
+            s2[l] ^= t;
+            s3[l] = rotl(s3[l], 11);
+            destination[i + l] = (result >> 8) * (1.f / 16777216.f);
+        }
+    }
+
+    for (int l = 0; l < 4; l++) {
+        lanes[0][l] = s0[l]; lanes[1][l] = s1[l]; lanes[2][l] = s2[l]; lanes[3][l] = s3[l];
+    }
+
+    for (; i < numSamples; i++) {
+        destination[i] = nextFloat();
+    }
+}
+
+void FastRandom::fillUniform(float *destination, int numSamples, float minimum, float maximum) {
+    fillUniform(destination, numSamples);
+    const float range = maximum - minimum;
+    for (int i = 0; i < numSamples; i++) {
+        destination[i] = destination[i] * range + minimum;
+    }
+}
+
+void FastRandom::fillBipolar(float *destination, int numSamples) {
+    fillUniform(destination, numSamples, -1.f, 1.f);
+}
+
+void FastRandom::setFixedSeed(uint64_t newSeed) {
+    fixedSeed = newSeed;
+    useFixedSeed = true;
+}
+
+void FastRandom::clearFixedSeed() {
+    useFixedSeed = false;
+}
+
+bool FastRandom::hasFixedSeed() {
+    return useFixedSeed;
+}
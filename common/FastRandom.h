@@ -0,0 +1,72 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+/* Small pseudo-random generator (xoshiro128+) owned by each instance, used
+   instead of the global rand() in the audio thread: no shared state between
+   instances running on different threads, and a few integer operations per
+   value.
+
+   Generators are seeded from the clock and a process-wide instance number.
+   With a fixed seed, set by setFixedSeed() or by the PLUGEX_RANDOM_SEED
+   environment variable, reseed() instead restarts every generator from that
+   seed and a salt given by its owner, so offline renders of the same session
+   are bit-identical whatever the order the instances were created in. The
+   salt must only depend on stable data (a channel or a role index), and
+   differ between the generators of a same owner. */
+class FastRandom {
+    public:
+        FastRandom();
+        ~FastRandom();
+
+        // Restarts the sequence, from the fixed seed and the salt if there
+        // is one.
+        void reseed(uint64_t salt = 0);
+        void setSeed(uint64_t newSeed);
+
+        // Uniform 32 bits integer.
+        inline uint32_t nextUInt() {
+            const uint32_t result = state[0] + state[3];
+            const uint32_t t = state[1] << 9;
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = (state[3] << 11) | (state[3] >> 21);
+            return result;
+        }
+
+        // Uniform float in [0, 1), from the 24 upper bits (the lowest bits
+        // of xoshiro128+ are the weakest).
+        inline float nextFloat() { return (nextUInt() >> 8) * (1.f / 16777216.f); }
+        // Uniform float in [-1, 1).
+        inline float nextBipolar() { return nextFloat() * 2.f - 1.f; }
+
+        // Block versions, running four independent streams side by side so
+        // that the loop is vectorized by the compiler.
+        void fillUniform(float *destination, int numSamples);
+        void fillUniform(float *destination, int numSamples, float minimum, float maximum);
+        void fillBipolar(float *destination, int numSamples);
+
+        static void setFixedSeed(uint64_t newSeed);
+        static void clearFixedSeed();
+        static bool hasFixedSeed();
+
+    private:
+        uint32_t state[4];
+        // State word k of block stream l is lanes[k][l].
+        uint32_t lanes[4][4];
+        uint64_t instanceNumber;
+};
@@ -0,0 +1,244 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#include "GranularFileSource.h"
+
+GranularFileSource::GranularFileSource()
+    : numChannels(0), length(0), sampleRate(44100.0), numSlots(0), slotFrames(0), channelStride(0),
+      numPages(0), requestFifo(512), clock(1)
+{
+    formatManager.registerBasicFormats();
+    requests.calloc(512);
+}
+
+GranularFileSource::~GranularFileSource()
+{
+    loader->removeTimeSliceClient(this);
+}
+
+bool GranularFileSource::open(const File &fileToOpen, int numberOfSlots)
+{
+    jassert(reader == nullptr);
+
+    // Memory mapped if possible: the loader thread then only copies and
+    // converts the samples, the OS brings the file in its page cache.
+    if (auto *format = formatManager.findFormatForFileExtension(fileToOpen.getFileExtension()))
+    {
+        std::unique_ptr<MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader(fileToOpen));
+        if (mapped != nullptr && mapped->mapEntireFile())
+            reader = std::move(mapped);
+    }
+    if (reader == nullptr)
+        reader.reset(formatManager.createReaderFor(fileToOpen));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+    {
+        reader.reset();
+        return false;
+    }
+
+    file = fileToOpen;
+    numChannels = jmin((int)reader->numChannels, (int)Granulator::maxChannels);
+    length = (long)reader->lengthInSamples;
+    sampleRate = reader->sampleRate;
+
+    numPages = (int)((length + pageFrames - 1) / pageFrames);
+    numSlots = jmax(1, jmin(numPages, numberOfSlots));
+    slotFrames = pageFrames + maxGrainFrames;
+    channelStride = (long)numSlots * slotFrames;
+    pool.calloc((size_t)(numChannels * channelStride));
+
+    slots.reset(new Slot[numSlots]);
+    for (int slot = 0; slot < numSlots; slot++)
+    {
+        slots[slot].pins = 0;
+        slots[slot].page = -1;
+        slots[slot].lastUse = 0;
+    }
+
+    pageSlots.reset(new std::atomic<int>[numPages]);
+    pageRequested.reset(new std::atomic<bool>[numPages]);
+    for (int page = 0; page < numPages; page++)
+    {
+        pageSlots[page] = -1;
+        pageRequested[page] = false;
+    }
+
+    loader->addTimeSliceClient(this);
+    return true;
+}
+
+const File &GranularFileSource::getFile() const
+{
+    return file;
+}
+
+double GranularFileSource::getSampleRate()
+{
+    return sampleRate;
+}
+
+long GranularFileSource::getLength()
+{
+    return length;
+}
+
+const float *GranularFileSource::getData()
+{
+    return pool.getData();
+}
+
+long GranularFileSource::getChannelOffset(int channel)
+{
+    // A mono file feeds every channel.
+    return channel < numChannels ? channel * channelStride : 0;
+}
+
+long GranularFileSource::acquire(long start, long frames, int &handle)
+{
+    if (start < 0 || start >= length || frames > maxGrainFrames)
+        return -1;
+
+    int page = (int)(start / pageFrames);
+    int slot = pageSlots[page];
+    if (slot < 0)
+    {
+        request(page);
+        return -1;
+    }
+
+    Slot &s = slots[slot];
+    int pins = s.pins;
+    do
+    {
+        if (pins < 0)
+            return -1;
+    } while (! s.pins.compare_exchange_weak(pins, pins + 1));
+
+    // The slot may have been given to another page before it was pinned.
+    if (pageSlots[page] != slot)
+    {
+        s.pins--;
+        return -1;
+    }
+
+    s.lastUse = clock.load();
+    handle = slot;
+    return (long)slot * slotFrames + (start - (long)page * pageFrames);
+}
+
+void GranularFileSource::release(int handle)
+{
+    slots[handle].pins--;
+}
+
+void GranularFileSource::prefetch(long start, long end)
+{
+    if (numPages == 0)
+        return;
+
+    uint32 now = ++clock;
+    // One page ahead of the region, where slowly moving positions go next.
+    int first = jlimit(0, numPages - 1, (int)(jmax(0L, start) / pageFrames));
+    int last = jlimit(0, numPages - 1, (int)(jmax(0L, end) / pageFrames) + 1);
+    for (int page = first; page <= last; page++)
+    {
+        int slot = pageSlots[page];
+        if (slot >= 0)
+            slots[slot].lastUse = now;
+        else
+            request(page);
+    }
+}
+
+void GranularFileSource::request(int page)
+{
+    if (pageRequested[page].exchange(true))
+        return;
+
+    int start1, size1, start2, size2;
+    requestFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 > 0)
+    {
+        requests[start1] = page;
+        requestFifo.finishedWrite(1);
+    }
+    else
+        pageRequested[page] = false;
+}
+
+int GranularFileSource::useTimeSlice()
+{
+    int start1, size1, start2, size2;
+    requestFifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 == 0)
+        return 10;
+
+    int page = requests[start1];
+    requestFifo.finishedRead(1);
+
+    if (pageSlots[page] < 0)
+        loadPage(page);
+    pageRequested[page] = false;
+
+    // Other requests may be waiting.
+    return 0;
+}
+
+void GranularFileSource::loadPage(int page)
+{
+    // Least recently used slot that no grain is reading, locked with pins = -1.
+    int victim = -1;
+    for (int attempt = 0; attempt < numSlots && victim < 0; attempt++)
+    {
+        int oldest = -1;
+        uint32 oldestUse = 0;
+        for (int slot = 0; slot < numSlots; slot++)
+        {
+            if (slots[slot].pins != 0)
+                continue;
+            uint32 use = slots[slot].lastUse;
+            if (oldest < 0 || use < oldestUse)
+            {
+                oldest = slot;
+                oldestUse = use;
+            }
+        }
+        if (oldest < 0)
+            return;  // Every slot is read by grains, the page will be requested again.
+
+        int expected = 0;
+        if (slots[oldest].pins.compare_exchange_strong(expected, -1))
+            victim = oldest;
+    }
+    if (victim < 0)
+        return;
+
+    Slot &s = slots[victim];
+    int oldPage = s.page;
+    if (oldPage >= 0)
+        pageSlots[oldPage] = -1;
+
+    float *channels[Granulator::maxChannels];
+    for (int channel = 0; channel < numChannels; channel++)
+        channels[channel] = pool.getData() + channel * channelStride + (long)victim * slotFrames;
+
+    long first = (long)page * pageFrames;
+    int frames = (int)jmin((long)slotFrames, length - first);
+    AudioBuffer<float> buffer (channels, numChannels, slotFrames);
+    reader->read(&buffer, 0, frames, first, true, numChannels > 1);
+    if (frames < slotFrames)
+        buffer.clear(frames, slotFrames - frames);
+
+    s.page = page;
+    s.lastUse = clock.load();
+    pageSlots[page] = victim;
+    s.pins = 0;
+}
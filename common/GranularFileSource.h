@@ -0,0 +1,104 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Granulator.h"
+
+/** Background thread, shared by all file sources, where pages are decoded. */
+class GranularFileLoader : public TimeSliceThread
+{
+public:
+    GranularFileLoader() : TimeSliceThread("Granular file loader") { startThread(4); }
+    ~GranularFileLoader() { stopThread(1000); }
+};
+
+/** Audio file granulated from disk instead of a live recording.
+
+    The file is memory mapped when its format allows it (wav, aiff) and read
+    through a regular reader otherwise. It is decoded by pages of pageFrames
+    frames, on the loader thread, into a fixed number of slots, so a source
+    uses the same memory whatever the length of the file. A slot also holds
+    the maxGrainFrames frames following its page, so that a grain starting
+    in a page never reads past its slot. Slots are recycled least recently
+    used first, never while a grain holds them.
+
+    A source is read by a single Granulator. */
+class GranularFileSource : public GrainSource, private TimeSliceClient
+{
+public:
+    enum
+    {
+        pageFrames = 1 << 17,
+        maxGrainFrames = 1 << 16,
+        defaultNumberOfSlots = 16
+    };
+
+    GranularFileSource();
+    ~GranularFileSource();
+
+    /** Opens the file, from the message thread, before the source is given
+        to a Granulator. Returns false if the file can't be read. */
+    bool open(const File &fileToOpen, int numberOfSlots = defaultNumberOfSlots);
+    const File &getFile() const;
+
+    double getSampleRate() override;
+    long getLength() override;
+    const float *getData() override;
+    long getChannelOffset(int channel) override;
+    long acquire(long start, long frames, int &handle) override;
+    void release(int handle) override;
+    void prefetch(long start, long end) override;
+
+private:
+    struct Slot
+    {
+        // Grains reading the slot, -1 while the loader refills it.
+        std::atomic<int> pins;
+        std::atomic<int> page;
+        std::atomic<uint32> lastUse;
+    };
+
+    int useTimeSlice() override;
+    void request(int page);
+    void loadPage(int page);
+
+    SharedResourcePointer<GranularFileLoader> loader;
+    AudioFormatManager formatManager;
+    std::unique_ptr<AudioFormatReader> reader;
+    File file;
+
+    int numChannels;
+    long length;
+    double sampleRate;
+
+    int numSlots;
+    int slotFrames;
+    // Slots of channel c start at c * channelStride in pool.
+    long channelStride;
+    HeapBlock<float> pool;
+    std::unique_ptr<Slot[]> slots;
+
+    int numPages;
+    // Slot holding each page, -1 if the page is not resident.
+    std::unique_ptr<std::atomic<int>[]> pageSlots;
+    std::unique_ptr<std::atomic<bool>[]> pageRequested;
+
+    // Pages wanted by the audio thread, read by the loader.
+    AbstractFifo requestFifo;
+    HeapBlock<int> requests;
+
+    // Advanced at every prefetch, stamps the slots for the eviction.
+    std::atomic<uint32> clock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GranularFileSource)
+};
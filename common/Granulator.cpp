@@ -10,22 +10,189 @@
 *******************************************************************************/
 
 #include <cmath>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "Granulator.h"
 
 #ifndef M_PI
 #define M_PI (3.14159265358979323846264338327950288)
 #endif
 
+static const int storageBlockShift = 6;
+static_assert((1 << storageBlockShift) == Granulator::storageBlockSize, "storageBlockShift");
+
+// Largest integer of the 16-bit and 24-bit formats.
+static const float int16Peak = 32767.f;
+static const float int24Peak = 8388607.f;
+
+/* Samples index and index + 1 of a channel, read from floats or decoded from
+   the block scaled integers. */
+template <int format>
+static inline void readPair(const float *samples, const unsigned char *packed, const float *scales,
+                            int index, float &s0, float &s1) {
+    if (format == Granulator::storeFloat32) {
+        s0 = samples[index];
+        s1 = samples[index + 1];
+        return;
+    }
+    int block = index >> storageBlockShift;
+    int slot = index + block;
+    float scale = scales[block];
+    if (format == Granulator::storeInt16) {
+        const short *words = reinterpret_cast<const short *> (packed) + slot;
+        s0 = words[0] * scale;
+        s1 = words[1] * scale;
+    } else {
+        // Little endian 24-bit, sign extended from the top of an int.
+        const unsigned char *bytes = packed + slot * 3;
+        s0 = ((int)((unsigned)bytes[0] << 8 | (unsigned)bytes[1] << 16 | (unsigned)bytes[2] << 24) >> 8) * scale;
+        s1 = ((int)((unsigned)bytes[3] << 8 | (unsigned)bytes[4] << 16 | (unsigned)bytes[5] << 24) >> 8) * scale;
+    }
+}
+
+#if GRANULATOR_USE_AVX2
+// readPair() for 8 lanes. A 16-bit pair comes with one 32-bit gather.
+template <int format>
+static inline void gatherPair(const float *samples, const unsigned char *packed, const float *scales,
+                              __m256i index, __m256 &s0, __m256 &s1) {
+    if (format == Granulator::storeFloat32) {
+        s0 = _mm256_i32gather_ps(samples, index, 4);
+        s1 = _mm256_i32gather_ps(samples + 1, index, 4);
+        return;
+    }
+    __m256i block = _mm256_srli_epi32(index, storageBlockShift);
+    __m256i slot = _mm256_add_epi32(index, block);
+    __m256 scale = _mm256_i32gather_ps(scales, block, 4);
+    __m256i w0, w1;
+    if (format == Granulator::storeInt16) {
+        w1 = _mm256_i32gather_epi32(reinterpret_cast<const int *> (packed), slot, 2);
+        w0 = _mm256_srai_epi32(_mm256_slli_epi32(w1, 16), 16);
+        w1 = _mm256_srai_epi32(w1, 16);
+    } else {
+        __m256i offset = _mm256_add_epi32(_mm256_add_epi32(slot, slot), slot);
+        w0 = _mm256_i32gather_epi32(reinterpret_cast<const int *> (packed), offset, 1);
+        w1 = _mm256_i32gather_epi32(reinterpret_cast<const int *> (packed + 3), offset, 1);
+        w0 = _mm256_srai_epi32(_mm256_slli_epi32(w0, 8), 8);
+        w1 = _mm256_srai_epi32(_mm256_slli_epi32(w1, 8), 8);
+    }
+    s0 = _mm256_mul_ps(_mm256_cvtepi32_ps(w0), scale);
+    s1 = _mm256_mul_ps(_mm256_cvtepi32_ps(w1), scale);
+}
+#endif
+
+// Threads of the task renderer. Tasks are taken in any order by the workers
+// and by the thread running the job, which waits for the last ones.
+struct Granulator::RenderWorkers {
+    RenderWorkers(Granulator &granulator, int numberOfWorkers) : owner(granulator) {
+        job = 0;
+        quit = false;
+        numTasks = 0;
+        tasksDone = 0;
+        tickets = 0;
+        for (int i = 0; i < numberOfWorkers; i++) {
+            threads.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~RenderWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wakeUp.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    void run(int numberOfTasks) {
+        unsigned int currentJob;
+        {
+            // Workers read the job and its number of tasks together, under the lock.
+            std::lock_guard<std::mutex> lock(mutex);
+            currentJob = ++job;
+            numTasks = numberOfTasks;
+            tasksDone = 0;
+            tickets = static_cast<std::uint64_t> (currentJob) << 32;
+        }
+        if (numberOfTasks > 1 && ! threads.empty()) {
+            wakeUp.notify_all();
+        }
+        work(currentJob, numberOfTasks);
+        while (tasksDone.load() < numberOfTasks) {
+            std::this_thread::yield();
+        }
+    }
+
+    /* A ticket holds its job in the high 32 bits and the next task in the
+       low ones. It is only taken if it still belongs to the job of the
+       caller, so a worker late from an earlier job never takes (or skips) a
+       task of the current one. */
+    void work(unsigned int currentJob, int numberOfTasks) {
+        std::uint64_t ticket = tickets.load();
+        for (;;) {
+            if (static_cast<unsigned int> (ticket >> 32) != currentJob)
+                break;
+            int task = static_cast<int> (ticket & 0xFFFFFFFFu);
+            if (task >= numberOfTasks)
+                break;
+            if (! tickets.compare_exchange_weak(ticket, ticket + 1))
+                continue;
+            owner.renderTask(task);
+            tasksDone++;
+            ticket = tickets.load();
+        }
+    }
+
+    void workerLoop() {
+        unsigned int seen = 0;
+        for (;;) {
+            int numberOfTasks;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [&] { return quit || job != seen; });
+                if (quit)
+                    return;
+                seen = job;
+                numberOfTasks = numTasks;
+            }
+            work(seen, numberOfTasks);
+        }
+    }
+
+    Granulator &owner;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    unsigned int job;
+    bool quit;
+    int numTasks;
+    std::atomic<std::uint64_t> tickets;
+    std::atomic<int> tasksDone;
+};
+
 Granulator::Granulator() {
+    m_sampleRate = 44100.0;
     maxSize = recordingSize = 0;
+    numberOfActiveGrains = 0;
+    storage = storeFloat32;
+    stagedFrames = 0;
+    source = nullptr;
     initialized = false;
+    renderThreadsEnabled = true;
 }
 
 Granulator::~Granulator() {}
 
-void Granulator::setup(double sampleRate, double memorySize) {
+void Granulator::setup(double sampleRate, double memorySize, int numberOfChannels, int storageFormat) {
+    releaseAllGrains();
     m_sampleRate = sampleRate;
     maxSize = recordingSize = static_cast<long> (m_sampleRate * memorySize);
+    numChannels = numberOfChannels < 1 ? 1 : numberOfChannels > maxChannels ? maxChannels : numberOfChannels;
+    channelStride = maxSize + 1;
 
     isRecording = false;
     recordingIndex = 0;
@@ -33,39 +200,151 @@ void Granulator::setup(double sampleRate, double memorySize) {
     oneOverSr = 1.0 / sampleRate;
     timer = 1.0;
     deviationFactor = 1.0;
-    numberOfActiveGrains = 0;
-
     density = 50.f;
     pitch = 1.f;
     position = 0.f;
     duration = 0.1f;
     deviation = 0.f;
+    envelope = hann;
 
     gainFactor = sqrtf(sqrtf(density));
 
-    data.reset( new float[maxSize + 1] );
-    std::fill(data.get(), data.get() + maxSize + 1, 0.f);
+    storage = storageFormat == storeInt16 || storageFormat == storeInt24 ? storageFormat : storeFloat32;
+    stagedFrames = 0;
+    if (storage == storeFloat32) {
+        data.reset( new float[numChannels * channelStride] );
+        std::fill(data.get(), data.get() + numChannels * channelStride, 0.f);
+        packed.reset();
+        packedStride = scaleStride = 0;
+        scales.clear();
+        staging.clear();
+    } else {
+        // Every block takes storageBlockSize + 1 slots. The 32-bit loads of
+        // the renderer may read 2 bytes past the last slot.
+        scaleStride = maxSize / storageBlockSize + 1;
+        long slotBytes = storage == storeInt16 ? 2 : 3;
+        packedStride = (scaleStride * (storageBlockSize + 1) * slotBytes + 2 + 3) & ~3L;
+        packed.reset( new unsigned char[numChannels * packedStride] );
+        std::fill(packed.get(), packed.get() + numChannels * packedStride, 0);
+        scales.assign(numChannels * scaleStride, 0.f);
+        staging.assign(maxChannels * (storageBlockSize + 1), 0.f);
+        data.reset();
+    }
 
-    srand(static_cast<unsigned int>(time(NULL)));
+    // Salt 0 is left to the owner's own generator.
+    random.reseed(1);
     gpos.resize(maxNumberOfGrains, 0.f);
     glen.resize(maxNumberOfGrains, 0.f);
     ginc.resize(maxNumberOfGrains, 0.f);
     gphs.resize(maxNumberOfGrains, 0.f);
-    flags.resize(maxNumberOfGrains, 0);
+    genv.resize(maxNumberOfGrains, 0);
+    gbase.resize(maxNumberOfGrains, 0);
+    ghandle.resize(maxNumberOfGrains, -1);
+    gstart.resize(maxNumberOfGrains, 0);
+
+    envelopes.resize(numberOfEnvelopes * (envelopeSize + 1));
+    for (int type = 0; type < numberOfEnvelopes; type++) {
+        float *table = &envelopes[type * (envelopeSize + 1)];
+        for (int i = 0; i <= envelopeSize; i++) {
+            float x = i / (float)envelopeSize;
+            float value = 0.f;
+            switch (type) {
+                case hann:
+                    value = 0.5f - 0.5f * cosf(M_PI * 2.f * x);
+                    break;
+                case tukey:
+                    // Cosine ramps over the first and last quarters.
+                    if (x < 0.25f)
+                        value = 0.5f - 0.5f * cosf(M_PI * x / 0.25f);
+                    else if (x > 0.75f)
+                        value = 0.5f - 0.5f * cosf(M_PI * (1.f - x) / 0.25f);
+                    else
+                        value = 1.f;
+                    break;
+                case gaussian: {
+                    // Shifted and rescaled so that both ends reach 0.
+                    float edge = expf(-0.5f * (0.5f / 0.15f) * (0.5f / 0.15f));
+                    float g = expf(-0.5f * ((x - 0.5f) / 0.15f) * ((x - 0.5f) / 0.15f));
+                    value = (g - edge) / (1.f - edge);
+                    break;
+                }
+                case trapezoid:
+                    value = x < 0.2f ? x / 0.2f : x > 0.8f ? (1.f - x) / 0.2f : 1.f;
+                    break;
+                case expodec: {
+                    // Short linear attack, then an exponential decay ending at 0.
+                    const float attack = 0.02f;
+                    float edge = expf(-6.f);
+                    if (x < attack)
+                        value = x / attack;
+                    else
+                        value = (expf(-6.f * (x - attack) / (1.f - attack)) - edge) / (1.f - edge);
+                    break;
+                }
+            }
+            table[i] = value < 0.f ? 0.f : value;
+        }
+    }
+
+    numberOfActiveGrains = 0;
+
+    numberOfOnsets = 0;
+    onsetSample.resize(maxBlockSize, 0);
+    onsetPosition.resize(maxBlockSize, 0.f);
+    onsetLength.resize(maxBlockSize, 0.f);
+    onsetIncrement.resize(maxBlockSize, 0.f);
+    blockGain.resize(maxBlockSize, 0.f);
+
+    // Read pointers for the new recording buffer, or the new sample rate.
+    setSource(source);
 
     initialized = true;
 }
 
+void Granulator::setSource(GrainSource *newSource) {
+    releaseAllGrains();
+    source = newSource;
+    if (source != nullptr) {
+        isRecording = false;
+        sourceRatio = source->getSampleRate() / m_sampleRate;
+        sourceLength = source->getLength();
+        readData = source->getData();
+        for (int channel = 0; channel < maxChannels; channel++) {
+            readOffsets[channel] = source->getChannelOffset(channel);
+        }
+    } else {
+        sourceRatio = 1.0;
+        sourceLength = 0;
+        readData = data.get();
+        for (int channel = 0; channel < maxChannels; channel++) {
+            int stored = channel < numChannels ? channel : 0;
+            readOffsets[channel] = data != nullptr ? stored * channelStride : 0;
+            readPacked[channel] = packed.get() + stored * packedStride;
+            readScales[channel] = scales.data() + stored * scaleStride;
+        }
+    }
+}
+
+GrainSource *Granulator::getSource() {
+    return source;
+}
+
 void Granulator::setRecording(bool shouldBeRecording) {
-    isRecording = shouldBeRecording;
+    // There is nothing to record into while a source is set.
+    isRecording = shouldBeRecording && source == nullptr;
     recordingIndex = 0;
     recordedSize = 0;
+    stagedFrames = 0;
 }
 
 bool Granulator::getIsRecording() {
     return isRecording;
 }
 
+long Granulator::getRemainingRecordingSamples() {
+    return isRecording ? recordingSize - recordingIndex : 0;
+}
+
 void Granulator::setDensity(float newDensity) {
     density = newDensity < 1.f ? 1.f : newDensity;
     gainFactor = sqrtf(sqrtf(density));
@@ -87,6 +366,22 @@ void Granulator::setDeviation(float newDeviation) {
     deviation = newDeviation;
 }
 
+void Granulator::setEnvelope(int newEnvelope) {
+    envelope = newEnvelope < 0 ? 0 : newEnvelope >= numberOfEnvelopes ? numberOfEnvelopes - 1 : newEnvelope;
+}
+
+void Granulator::setRenderThreads(int numberOfThreads) {
+    workers.reset();
+    if (numberOfThreads > 0) {
+        taskOutputs.assign((maxNumberOfGrains / grainsPerTask) * maxChannels * maxBlockSize, 0.f);
+        workers.reset(new RenderWorkers(*this, numberOfThreads - 1));
+    }
+}
+
+void Granulator::setRenderThreadsEnabled(bool shouldBeEnabled) {
+    renderThreadsEnabled = shouldBeEnabled;
+}
+
 void Granulator::setRecordingSize(double newRecordingSize) {
     recordingSize = static_cast<long> (m_sampleRate * newRecordingSize);
     if (recordingSize > maxSize)
@@ -94,57 +389,498 @@ void Granulator::setRecordingSize(double newRecordingSize) {
 }
 
 float Granulator::process(float input) {
-    if (! initialized) 
-        return 0.f;
+    float output = 0.f;
+    const float *inputs[maxChannels] = { &input, &input };
+    float *outputs[maxChannels] = { &output, &output };
+    processBlock(inputs, outputs, 1);
+    return output;
+}
+
+void Granulator::processBlock(const float * const *inputs, float * const *outputs, int numSamples,
+                              const BlockParameters &parameters) {
+    if (! initialized) {
+        for (int channel = 0; channel < numChannels; channel++) {
+            std::fill(outputs[channel], outputs[channel] + numSamples, 0.f);
+        }
+        return;
+    }
+
+    float frame[maxChannels];
+    for (int offset = 0; offset < numSamples; offset += maxBlockSize) {
+        int blockSize = numSamples - offset < maxBlockSize ? numSamples - offset : maxBlockSize;
+        scheduleGrains(blockSize, parameters, offset);
+
+        if (workers != nullptr && renderThreadsEnabled) {
+            processSubBlockInTasks(inputs, outputs, blockSize, offset);
+            continue;
+        }
+
+        int onset = 0;
+        for (int i = 0; i < blockSize; i++) {
+            recordSample(inputs, offset + i);
+
+            if (onset < numberOfOnsets && onsetSample[onset] == i) {
+                startGrain(onset++);
+            }
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                frame[channel] = 0.f;
+            }
+            if (numberOfActiveGrains > 0) {
+                renderGrains<false>(0, numberOfActiveGrains, i, frame);
+                removeFinishedGrains();
+            }
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                outputs[channel][offset + i] = frame[channel] * blockGain[i];
+            }
+        }
+    }
+}
 
+void Granulator::recordSample(const float * const *inputs, int index) {
     if (isRecording && recordingIndex < recordingSize) {
-        data[recordingIndex++] = input;
+        if (storage == storeFloat32) {
+            for (int channel = 0; channel < numChannels; channel++) {
+                data[channel * channelStride + recordingIndex] = inputs[channel][index];
+            }
+        } else {
+            for (int channel = 0; channel < numChannels; channel++) {
+                staging[channel * (storageBlockSize + 1) + stagedFrames] = inputs[channel][index];
+            }
+            stagedFrames++;
+        }
+        recordingIndex++;
         if (recordingIndex == recordingSize) {
             isRecording = false;
         }
-        recordedSize = recordingIndex - 1;
+        if (storage == storeFloat32) {
+            recordedSize = recordingIndex - 1;
+        } else if (stagedFrames == storageBlockSize + 1 || ! isRecording) {
+            // The grains only read encoded blocks.
+            encodeStagedBlock();
+            recordedSize = recordingIndex - 1;
+        }
+    }
+}
+
+void Granulator::encodeStagedBlock() {
+    int block = static_cast<int> ((recordingIndex - stagedFrames) >> storageBlockShift);
+    float peak = storage == storeInt16 ? int16Peak : int24Peak;
+    int top = static_cast<int> (peak);
+    for (int channel = 0; channel < numChannels; channel++) {
+        const float *frames = &staging[channel * (storageBlockSize + 1)];
+        float largest = 0.f;
+        for (int i = 0; i < stagedFrames; i++) {
+            largest = fabsf(frames[i]) > largest ? fabsf(frames[i]) : largest;
+        }
+        float toInteger = largest > 0.f ? peak / largest : 0.f;
+        scales[channel * scaleStride + block] = largest / peak;
+
+        // An incomplete last block is padded with zeros.
+        long slot = static_cast<long> (block) * (storageBlockSize + 1);
+        unsigned char *bytes = packed.get() + channel * packedStride;
+        for (int i = 0; i <= storageBlockSize; i++) {
+            // The peak itself may round one step over the largest integer.
+            int value = i < stagedFrames ? static_cast<int> (lrintf(frames[i] * toInteger)) : 0;
+            value = value > top ? top : value < -top ? -top : value;
+            if (storage == storeInt16) {
+                reinterpret_cast<short *> (bytes)[slot + i] = static_cast<short> (value);
+            } else {
+                unsigned char *sample = bytes + (slot + i) * 3;
+                sample[0] = static_cast<unsigned char> (value);
+                sample[1] = static_cast<unsigned char> (value >> 8);
+                sample[2] = static_cast<unsigned char> (value >> 16);
+            }
+        }
+    }
+
+    // The last frame also starts the next block.
+    if (stagedFrames == storageBlockSize + 1) {
+        for (int channel = 0; channel < numChannels; channel++) {
+            staging[channel * (storageBlockSize + 1)] = staging[channel * (storageBlockSize + 1) + storageBlockSize];
+        }
+        stagedFrames = 1;
+    } else {
+        stagedFrames = 0;
     }
+}
 
-    bool needNewGrain = false;
-    double timeIncrement = density * oneOverSr * deviationFactor;
-    timer += timeIncrement;
-    if (timer >= 1.0) {
-        timer -= 1.0;
-        needNewGrain = true;
+void Granulator::processSubBlockInTasks(const float * const *inputs, float * const *outputs,
+                                        int blockSize, int offset) {
+    // The whole sub-block is recorded and its grains started first, each new
+    // grain keeps the sample where it starts.
+    int onset = 0;
+    for (int i = 0; i < blockSize; i++) {
+        recordSample(inputs, offset + i);
+        if (onset < numberOfOnsets && onsetSample[onset] == i) {
+            int previous = numberOfActiveGrains;
+            startGrain(onset++);
+            if (numberOfActiveGrains > previous)
+                gstart[previous] = i;
+        }
     }
 
-    float out = 0.f;
+    int numTasks = (numberOfActiveGrains + grainsPerTask - 1) / grainsPerTask;
+    renderBlockSize = blockSize;
+    if (numTasks > 0)
+        workers->run(numTasks);
 
-    if (needNewGrain) {
-        for (int j = 0; j < maxNumberOfGrains; j++) {
-            if (flags[j] == 0) {
-                flags[j] = 1;
-                if (j >= numberOfActiveGrains)
-                    numberOfActiveGrains = j + 1;
-                gpos[j] = position * recordedSize;
-                glen[j] = duration * m_sampleRate * pitch;
-                if ((gpos[j] + glen[j]) >= recordedSize || (gpos[j] + glen[j]) < 0)
-                    flags[j] = false;
-                gphs[j] = 0.f;
-                ginc[j] = 1.f / (duration * m_sampleRate);
-                deviationFactor = (rand() / (float)RAND_MAX * 2.0 - 1.0) * deviation + 1.0;
-                break;
+    for (int channel = 0; channel < numChannels; channel++) {
+        float *output = outputs[channel] + offset;
+        for (int i = 0; i < blockSize; i++) {
+            output[i] = 0.f;
+        }
+        for (int task = 0; task < numTasks; task++) {
+            const float *partial = &taskOutputs[(task * maxChannels + channel) * maxBlockSize];
+            for (int i = 0; i < blockSize; i++) {
+                output[i] += partial[i];
             }
         }
+        for (int i = 0; i < blockSize; i++) {
+            output[i] *= blockGain[i];
+        }
+    }
+
+    removeFinishedGrains();
+    for (int k = 0; k < numberOfActiveGrains; k++) {
+        gstart[k] = 0;
+    }
+}
+
+void Granulator::renderTask(int task) {
+    int begin = task * grainsPerTask;
+    int end = begin + grainsPerTask < numberOfActiveGrains ? begin + grainsPerTask : numberOfActiveGrains;
+    float *partial = &taskOutputs[task * maxChannels * maxBlockSize];
+    float frame[maxChannels];
+    for (int i = 0; i < renderBlockSize; i++) {
+        for (int channel = 0; channel < numChannels; channel++) {
+            frame[channel] = 0.f;
+        }
+        renderGrains<true>(begin, end, i, frame);
+        for (int channel = 0; channel < numChannels; channel++) {
+            partial[channel * maxBlockSize + i] = frame[channel];
+        }
     }
+}
 
-    for (int j = 0; j < numberOfActiveGrains; j++) {
-        if (flags[j]) {
-            float amp = cosf(M_PI * 2.f * gphs[j]) * -0.5f + 0.5f;
-            float index = gphs[j] * glen[j] + gpos[j];
-            int ipart = (int)index;
-            float val = (data[ipart] + (data[ipart+1] - data[ipart]) * (index - ipart)) * amp;
-            out += val;
-            gphs[j] += ginc[j];
-            if (gphs[j] >= 1.0)
-                flags[j] = 0;
+void Granulator::scheduleGrains(int numSamples, const BlockParameters &parameters, int offset) {
+    // Only the grain clock runs here, the grains are started by processBlock()
+    // once the recording has reached their onsets.
+    numberOfOnsets = 0;
+    float lowestPosition = 1.f, highestPosition = 0.f, longestGrain = 0.f;
+    for (int i = 0; i < numSamples; i++) {
+        float grainDensity = density;
+        if (parameters.density != nullptr) {
+            grainDensity = parameters.density[offset + i] < 1.f ? 1.f : parameters.density[offset + i];
         }
+        blockGain[i] = parameters.density != nullptr ? 1.f / sqrtf(sqrtf(grainDensity)) : 1.f / gainFactor;
+
+        timer += grainDensity * oneOverSr * deviationFactor;
+        if (timer >= 1.0) {
+            timer -= 1.0;
+            float grainPitch = parameters.pitch != nullptr ? parameters.pitch[offset + i] : pitch;
+            float grainDuration = parameters.duration != nullptr ? parameters.duration[offset + i] : duration;
+            float grainDeviation = parameters.deviation != nullptr ? parameters.deviation[offset + i] : deviation;
+            onsetSample[numberOfOnsets] = i;
+            onsetPosition[numberOfOnsets] = parameters.position != nullptr ? parameters.position[offset + i] : position;
+            onsetLength[numberOfOnsets] = grainDuration * m_sampleRate * grainPitch;
+            onsetIncrement[numberOfOnsets] = 1.f / (grainDuration * m_sampleRate);
+            numberOfOnsets++;
+            deviationFactor = random.nextBipolar() * grainDeviation + 1.0;
+        }
+
+        if (source != nullptr) {
+            float grainPosition = parameters.position != nullptr ? parameters.position[offset + i] : position;
+            float grainPitch = parameters.pitch != nullptr ? parameters.pitch[offset + i] : pitch;
+            float grainDuration = parameters.duration != nullptr ? parameters.duration[offset + i] : duration;
+            lowestPosition = grainPosition < lowestPosition ? grainPosition : lowestPosition;
+            highestPosition = grainPosition > highestPosition ? grainPosition : highestPosition;
+            float grainSpan = fabsf(grainDuration * grainPitch);
+            longestGrain = grainSpan > longestGrain ? grainSpan : longestGrain;
+        }
+    }
+
+    if (source != nullptr && lowestPosition <= highestPosition) {
+        // Every frame the grains of the coming blocks may read, the source
+        // loads ahead of that region.
+        double grainFrames = longestGrain * m_sampleRate * sourceRatio;
+        source->prefetch(static_cast<long> (lowestPosition * sourceLength - grainFrames),
+                         static_cast<long> (highestPosition * sourceLength + grainFrames) + 1);
+    }
+}
+
+void Granulator::startGrain(int onset) {
+    if (numberOfActiveGrains >= maxNumberOfGrains)
+        return;
+
+    int j = numberOfActiveGrains;
+    if (source != nullptr) {
+        // The grain reads relative to its first frame, so the float index
+        // stays small (and precise) whatever the length of the source.
+        double start = onsetPosition[onset] * (double)sourceLength;
+        double length = onsetLength[onset] * sourceRatio;
+        double lowest = length < 0.0 ? start + length : start;
+        if (lowest < 0.0 || lowest + fabs(length) + 1.0 >= sourceLength)
+            return;
+        long first = static_cast<long> (lowest);
+        int handle;
+        long base = source->acquire(first, static_cast<long> (fabs(length)) + 2, handle);
+        if (base < 0)
+            return;
+        gpos[j] = static_cast<float> (start - first);
+        glen[j] = static_cast<float> (length);
+        gbase[j] = static_cast<int> (base);
+        ghandle[j] = handle;
+        gphs[j] = 0.f;
+        ginc[j] = onsetIncrement[onset];
+        genv[j] = envelope * (envelopeSize + 1);
+        numberOfActiveGrains++;
+        return;
     }
 
-    return out / gainFactor;
+    gbase[j] = 0;
+    ghandle[j] = -1;
+    gpos[j] = onsetPosition[onset] * recordedSize;
+    glen[j] = onsetLength[onset];
+    gphs[j] = 0.f;
+    ginc[j] = onsetIncrement[onset];
+    genv[j] = envelope * (envelopeSize + 1);
+    if ((gpos[j] + glen[j]) < recordedSize && (gpos[j] + glen[j]) >= 0)
+        numberOfActiveGrains++;
+}
+
+template <bool masked>
+void Granulator::renderGrains(int begin, int end, int sample, float *frame) {
+    // A source is always read as floats.
+    switch (source != nullptr ? static_cast<int> (storeFloat32) : storage) {
+        case storeInt16:
+            renderGrainsAs<masked, storeInt16>(begin, end, sample, frame);
+            break;
+        case storeInt24:
+            renderGrainsAs<masked, storeInt24>(begin, end, sample, frame);
+            break;
+        default:
+            renderGrainsAs<masked, storeFloat32>(begin, end, sample, frame);
+            break;
+    }
+}
+
+template <bool masked, int format>
+void Granulator::renderGrainsAs(int begin, int end, int sample, float *frame) {
+    // Envelope, read position and phase are computed once per grain, only
+    // the sample reads are done for every channel.
+    const float *samples[maxChannels];
+    for (int channel = 0; channel < maxChannels; channel++) {
+        samples[channel] = readData + readOffsets[channel];
+    }
+    const int *base = gbase.data();
+    const int *start = gstart.data();
+    const float *tables = envelopes.data();
+    float *phs = gphs.data();
+    const float *pos = gpos.data();
+    const float *len = glen.data();
+    const float *inc = ginc.data();
+    const int *env = genv.data();
+    const float tableSize = (float)envelopeSize;
+
+    int k = begin;
+
+    // In the masked renderer, lanes of silent grains read at phase 0 (a
+    // valid frame) and get a null amplitude and increment.
+#if GRANULATOR_USE_AVX2
+    __m256 sum[maxChannels] = { _mm256_setzero_ps(), _mm256_setzero_ps() };
+    const __m256 size8 = _mm256_set1_ps(tableSize);
+    const __m256 one8 = _mm256_set1_ps(1.f);
+    const __m256i sample8 = _mm256_set1_epi32(sample);
+    for ( ; k + 8 <= end; k += 8) {
+        __m256 phase = _mm256_loadu_ps(phs + k);
+        __m256 step = _mm256_loadu_ps(inc + k);
+        __m256 read = phase;
+        __m256 active = one8;
+        if (masked) {
+            __m256i waiting = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(start + k)), sample8);
+            active = _mm256_andnot_ps(_mm256_castsi256_ps(waiting), _mm256_cmp_ps(phase, one8, _CMP_LT_OQ));
+            read = _mm256_and_ps(phase, active);
+            step = _mm256_and_ps(step, active);
+        }
+
+        __m256 envelopeIndex = _mm256_mul_ps(read, size8);
+        __m256i envelopePart = _mm256_cvttps_epi32(envelopeIndex);
+        __m256 envelopeFrac = _mm256_sub_ps(envelopeIndex, _mm256_cvtepi32_ps(envelopePart));
+        __m256i envelopeOffset = _mm256_add_epi32(envelopePart, _mm256_loadu_si256((const __m256i *)(env + k)));
+        __m256 e0 = _mm256_i32gather_ps(tables, envelopeOffset, 4);
+        __m256 e1 = _mm256_i32gather_ps(tables + 1, envelopeOffset, 4);
+        __m256 amp = _mm256_add_ps(e0, _mm256_mul_ps(_mm256_sub_ps(e1, e0), envelopeFrac));
+        if (masked)
+            amp = _mm256_and_ps(amp, active);
+
+        __m256 index = _mm256_add_ps(_mm256_mul_ps(read, _mm256_loadu_ps(len + k)), _mm256_loadu_ps(pos + k));
+        __m256i ipart = _mm256_cvttps_epi32(index);
+        __m256 frac = _mm256_sub_ps(index, _mm256_cvtepi32_ps(ipart));
+        ipart = _mm256_add_epi32(ipart, _mm256_loadu_si256((const __m256i *)(base + k)));
+        for (int channel = 0; channel < numChannels; channel++) {
+            __m256 s0, s1;
+            gatherPair<format>(samples[channel], readPacked[channel], readScales[channel], ipart, s0, s1);
+            __m256 val = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_sub_ps(s1, s0), frac));
+            sum[channel] = _mm256_add_ps(sum[channel], _mm256_mul_ps(val, amp));
+        }
+
+        _mm256_storeu_ps(phs + k, _mm256_add_ps(phase, step));
+    }
+    for (int channel = 0; channel < numChannels; channel++) {
+        float lanes[8];
+        _mm256_storeu_ps(lanes, sum[channel]);
+        for (int i = 0; i < 8; i++) {
+            frame[channel] += lanes[i];
+        }
+    }
+#elif GRANULATOR_USE_SSE2 || GRANULATOR_USE_NEON
+    // No gathers: the lane indices are stored and the samples and envelope
+    // points are loaded one by one into small staging arrays.
+    alignas(16) int sampleIndex[4];
+    alignas(16) int envelopeOffset[4];
+    alignas(16) float s0[maxChannels][4], s1[maxChannels][4], e0[4], e1[4];
+  #if GRANULATOR_USE_SSE2
+    __m128 sum[maxChannels] = { _mm_setzero_ps(), _mm_setzero_ps() };
+    const __m128 size4 = _mm_set1_ps(tableSize);
+    const __m128 one4 = _mm_set1_ps(1.f);
+    const __m128i sample4 = _mm_set1_epi32(sample);
+  #else
+    float32x4_t sum[maxChannels] = { vdupq_n_f32(0.f), vdupq_n_f32(0.f) };
+    const float32x4_t one4 = vdupq_n_f32(1.f);
+    const int32x4_t sample4 = vdupq_n_s32(sample);
+  #endif
+    for ( ; k + 4 <= end; k += 4) {
+  #if GRANULATOR_USE_SSE2
+        __m128 phase = _mm_loadu_ps(phs + k);
+        __m128 step = _mm_loadu_ps(inc + k);
+        __m128 read = phase;
+        __m128 active = one4;
+        if (masked) {
+            __m128i waiting = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(start + k)), sample4);
+            active = _mm_andnot_ps(_mm_castsi128_ps(waiting), _mm_cmplt_ps(phase, one4));
+            read = _mm_and_ps(phase, active);
+            step = _mm_and_ps(step, active);
+        }
+        __m128 envelopeIndex = _mm_mul_ps(read, size4);
+        __m128i envelopePart = _mm_cvttps_epi32(envelopeIndex);
+        __m128 envelopeFrac = _mm_sub_ps(envelopeIndex, _mm_cvtepi32_ps(envelopePart));
+        _mm_store_si128((__m128i *)envelopeOffset, _mm_add_epi32(envelopePart, _mm_loadu_si128((const __m128i *)(env + k))));
+        __m128 index = _mm_add_ps(_mm_mul_ps(read, _mm_loadu_ps(len + k)), _mm_loadu_ps(pos + k));
+        __m128i ipart = _mm_cvttps_epi32(index);
+        __m128 frac = _mm_sub_ps(index, _mm_cvtepi32_ps(ipart));
+        _mm_store_si128((__m128i *)sampleIndex, _mm_add_epi32(ipart, _mm_loadu_si128((const __m128i *)(base + k))));
+  #else
+        float32x4_t phase = vld1q_f32(phs + k);
+        float32x4_t step = vld1q_f32(inc + k);
+        float32x4_t read = phase;
+        uint32x4_t active = vdupq_n_u32(0xFFFFFFFFu);
+        if (masked) {
+            uint32x4_t waiting = vcgtq_s32(vld1q_s32(start + k), sample4);
+            active = vbicq_u32(vcltq_f32(phase, one4), waiting);
+            read = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(phase), active));
+            step = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(step), active));
+        }
+        float32x4_t envelopeIndex = vmulq_n_f32(read, tableSize);
+        int32x4_t envelopePart = vcvtq_s32_f32(envelopeIndex);
+        float32x4_t envelopeFrac = vsubq_f32(envelopeIndex, vcvtq_f32_s32(envelopePart));
+        vst1q_s32(envelopeOffset, vaddq_s32(envelopePart, vld1q_s32(env + k)));
+        float32x4_t index = vmlaq_f32(vld1q_f32(pos + k), read, vld1q_f32(len + k));
+        int32x4_t ipart = vcvtq_s32_f32(index);
+        float32x4_t frac = vsubq_f32(index, vcvtq_f32_s32(ipart));
+        vst1q_s32(sampleIndex, vaddq_s32(ipart, vld1q_s32(base + k)));
+  #endif
+        for (int i = 0; i < 4; i++) {
+            e0[i] = tables[envelopeOffset[i]];
+            e1[i] = tables[envelopeOffset[i] + 1];
+            for (int channel = 0; channel < numChannels; channel++) {
+                readPair<format>(samples[channel], readPacked[channel], readScales[channel],
+                                 sampleIndex[i], s0[channel][i], s1[channel][i]);
+            }
+        }
+  #if GRANULATOR_USE_SSE2
+        __m128 a0 = _mm_load_ps(e0);
+        __m128 amp = _mm_add_ps(a0, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(e1), a0), envelopeFrac));
+        if (masked)
+            amp = _mm_and_ps(amp, active);
+        for (int channel = 0; channel < numChannels; channel++) {
+            __m128 v0 = _mm_load_ps(s0[channel]);
+            __m128 val = _mm_add_ps(v0, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(s1[channel]), v0), frac));
+            sum[channel] = _mm_add_ps(sum[channel], _mm_mul_ps(val, amp));
+        }
+        _mm_storeu_ps(phs + k, _mm_add_ps(phase, step));
+  #else
+        float32x4_t a0 = vld1q_f32(e0);
+        float32x4_t amp = vmlaq_f32(a0, vsubq_f32(vld1q_f32(e1), a0), envelopeFrac);
+        if (masked)
+            amp = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(amp), active));
+        for (int channel = 0; channel < numChannels; channel++) {
+            float32x4_t v0 = vld1q_f32(s0[channel]);
+            float32x4_t val = vmlaq_f32(v0, vsubq_f32(vld1q_f32(s1[channel]), v0), frac);
+            sum[channel] = vmlaq_f32(sum[channel], val, amp);
+        }
+        vst1q_f32(phs + k, vaddq_f32(phase, step));
+  #endif
+    }
+    for (int channel = 0; channel < numChannels; channel++) {
+        float lanes[4];
+  #if GRANULATOR_USE_SSE2
+        _mm_storeu_ps(lanes, sum[channel]);
+  #else
+        vst1q_f32(lanes, sum[channel]);
+  #endif
+        for (int i = 0; i < 4; i++) {
+            frame[channel] += lanes[i];
+        }
+    }
+#endif
+
+    // Scalar tail, and the whole loop on targets without SIMD.
+    for ( ; k < end; k++) {
+        if (masked && (sample < start[k] || phs[k] >= 1.f))
+            continue;
+        float envelopeIndex = phs[k] * tableSize;
+        int envelopePart = (int)envelopeIndex;
+        const float *table = tables + env[k] + envelopePart;
+        float amp = table[0] + (table[1] - table[0]) * (envelopeIndex - envelopePart);
+        float index = phs[k] * len[k] + pos[k];
+        int ipart = (int)index;
+        float fpart = index - ipart;
+        for (int channel = 0; channel < numChannels; channel++) {
+            float s0, s1;
+            readPair<format>(samples[channel], readPacked[channel], readScales[channel],
+                             ipart + base[k], s0, s1);
+            frame[channel] += (s0 + (s1 - s0) * fpart) * amp;
+        }
+        phs[k] += inc[k];
+    }
+}
+
+void Granulator::removeFinishedGrains() {
+    // Backward, so that the grain moved into a freed slot was already checked.
+    for (int k = numberOfActiveGrains - 1; k >= 0; k--) {
+        if (gphs[k] >= 1.0) {
+            if (ghandle[k] >= 0)
+                source->release(ghandle[k]);
+            int last = --numberOfActiveGrains;
+            gpos[k] = gpos[last];
+            glen[k] = glen[last];
+            ginc[k] = ginc[last];
+            gphs[k] = gphs[last];
+            genv[k] = genv[last];
+            gbase[k] = gbase[last];
+            ghandle[k] = ghandle[last];
+        }
+    }
+}
+
+void Granulator::releaseAllGrains() {
+    if (source != nullptr) {
+        for (int k = 0; k < numberOfActiveGrains; k++) {
+            if (ghandle[k] >= 0)
+                source->release(ghandle[k]);
+        }
+    }
+    numberOfActiveGrains = 0;
 }
@@ -14,28 +14,156 @@
 #include <vector>
 #include <memory>
 
-#include <stdlib.h>
-#include <time.h>
+#include "FastRandom.h"
+
+// The grain renderer processes 8 grains at once with AVX2 gathers, 4 with
+// SSE2 or NEON (staged sample loads), with a scalar path for other targets.
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  #define GRANULATOR_USE_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define GRANULATOR_USE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define GRANULATOR_USE_NEON 1
+#endif
+
+/* Material read by the grains in place of the live recording, such as an
+   audio file streamed from disk (see GranularFileSource). The data lives in
+   one block of memory whose layout is fixed once the source is opened, the
+   regions are made resident on request. Every method is called from the
+   audio thread and must not block. */
+class GrainSource {
+    public:
+        virtual ~GrainSource() {}
+        virtual double getSampleRate() = 0;
+        // Number of frames in the source.
+        virtual long getLength() = 0;
+        // Samples of channel c start at getData() + getChannelOffset(c).
+        virtual const float *getData() = 0;
+        virtual long getChannelOffset(int channel) = 0;
+        /* Pins frames [start, start + length] and returns the offset of frame
+           start from the beginning of its channel, or -1 if they are not
+           resident yet (they are then requested). handle is given back to
+           release() when the grain is done. */
+        virtual long acquire(long start, long length, int &handle) = 0;
+        virtual void release(int handle) = 0;
+        // Grains are about to read frames in [start, end).
+        virtual void prefetch(long start, long end) = 0;
+};
 
 class Granulator {
     public:
+        enum {
+            maxChannels = 2,
+            // processBlock() splits longer blocks in sub-blocks of this size.
+            maxBlockSize = 256,
+            // Frames sharing a scale factor in the integer storage formats.
+            storageBlockSize = 64
+        };
+
+        /* How the recording is kept in memory. The integer formats scale
+           every block of storageBlockSize frames to its own peak, they take
+           about half (16-bit) or three quarters (24-bit) of the memory of
+           floats and are decoded by the grain renderer. */
+        enum StorageFormat {
+            storeFloat32 = 0,
+            storeInt16,
+            storeInt24
+        };
+
+        /** Per-sample parameter buffers for processBlock(), each one either
+            nullptr (the value of the setter is used) or numSamples values. */
+        struct BlockParameters {
+            BlockParameters() : density(nullptr), pitch(nullptr), position(nullptr),
+                                duration(nullptr), deviation(nullptr) {}
+            const float *density;
+            const float *pitch;
+            const float *position;
+            const float *duration;
+            const float *deviation;
+        };
+
+        enum EnvelopeType {
+            hann = 0,
+            tukey,
+            gaussian,
+            trapezoid,
+            expodec,
+            numberOfEnvelopes
+        };
+
         Granulator();
         ~Granulator();
-        void setup(double sampleRate, double memorySize);
+        void setup(double sampleRate, double memorySize, int numberOfChannels = 1,
+                   int storageFormat = storeFloat32);
+        // Single channel processing, with the values of the setters.
         float process(float input);
 
+        /* Records and granulates every channel. One scheduler computes the
+           grain onsets of each sub-block up front, and all the channels are
+           rendered from the same grains, so the stereo image stays coherent.
+           Inputs and outputs may point to the same buffers. */
+        void processBlock(const float * const *inputs, float * const *outputs, int numSamples,
+                          const BlockParameters &parameters = BlockParameters());
+
         void setRecordingSize(double newRecordingSize);
         void setRecording(bool shouldBeRecording);
         bool getIsRecording();
+        // Samples left before the end of the current recording.
+        long getRemainingRecordingSamples();
+
+        /* Granulates source instead of the recording, or the recording again
+           with nullptr. Recording is disabled while a source is set. Call it
+           from the audio thread, the playing grains are released. */
+        void setSource(GrainSource *newSource);
+        GrainSource *getSource();
 
         void setDensity(float newDensity);
         void setPitch(float newPitch);
         void setPosition(float newPosition);
         void setDuration(float newDuration);
         void setDeviation(float newDeviation);
+        // New grains use this envelope, playing grains keep their own.
+        void setEnvelope(int newEnvelope);
+
+        /* Renders the grains a whole sub-block at a time, split in tasks of
+           grainsPerTask grains shared by numberOfThreads threads (the one
+           calling processBlock() included). The partial outputs are summed
+           in task order, so the result does not depend on the number of
+           threads. 0 goes back to the sample by sample renderer. Starts and
+           stops threads, don't call it while processing. */
+        void setRenderThreads(int numberOfThreads);
+        // Switches between the threads set above and the sample by sample
+        // renderer without starting or stopping any thread, safe to call
+        // from the audio thread.
+        void setRenderThreadsEnabled(bool shouldBeEnabled);
 
     private:
+        void scheduleGrains(int numSamples, const BlockParameters &parameters, int offset);
+        void startGrain(int onset);
+        void processSubBlockInTasks(const float * const *inputs, float * const *outputs,
+                                    int blockSize, int offset);
+        void recordSample(const float * const *inputs, int index);
+        // Encodes the staged frames of the integer storage.
+        void encodeStagedBlock();
+        /* Sums grains [begin, end) for one sample. The masked version runs
+           over a sub-block: it skips grains before their start sample and
+           finished grains, which are only removed at the end. */
+        template <bool masked>
+        void renderGrains(int begin, int end, int sample, float *frame);
+        // renderGrains() for the format of the material read.
+        template <bool masked, int format>
+        void renderGrainsAs(int begin, int end, int sample, float *frame);
+        void renderTask(int task);
+        void removeFinishedGrains();
+        void releaseAllGrains();
+
         double m_sampleRate;
+        int numChannels;
+        // Distance between the recordings of two channels in data.
+        long channelStride;
         long maxSize;
         long recordingSize;
         long recordedSize;
@@ -43,6 +171,7 @@ class Granulator {
         bool initialized;
 
         const int maxNumberOfGrains = 4096;
+        const int envelopeSize = 8192;
 
         bool isRecording;
         long recordingIndex;
@@ -53,20 +182,75 @@ class Granulator {
         float position;
         float duration;
         float deviation;
+        int envelope;
 
         float gainFactor;
 
         double timer;
         double deviationFactor;
+        // Draws the onset deviations, reseeded by setup().
+        FastRandom random;
         double oneOverSr;
 
-        float numberOfActiveGrains;
+        // Playing grains, packed at the front of the arrays so that the
+        // renderer runs over contiguous lanes. A new grain is appended and a
+        // finished one is replaced by the last grain.
+        int numberOfActiveGrains;
 
         std::vector<float> gpos;
         std::vector<float> glen;
         std::vector<float> ginc;
         std::vector<float> gphs;
-        std::vector<int> flags;
+        std::vector<int> genv;
+        // Integer part of the read offset (grains of a source read relative
+        // positions in the pinned page), and the handle of the page.
+        std::vector<int> gbase;
+        std::vector<int> ghandle;
+        // First sample of the grain in the sub-block, for the task renderer.
+        std::vector<int> gstart;
+
+        // numberOfEnvelopes tables of envelopeSize + 1 points, linearly interpolated.
+        std::vector<float> envelopes;
+
+        // Onsets of the current sub-block, computed by scheduleGrains().
+        int numberOfOnsets;
+        std::vector<int> onsetSample;
+        std::vector<float> onsetPosition;
+        std::vector<float> onsetLength;
+        std::vector<float> onsetIncrement;
+        std::vector<float> blockGain;
 
         std::unique_ptr<float[]> data;
+
+        /* Integer storage. Each block is encoded with the first frame of the
+           next one, so both samples of an interpolated read share the scale
+           of their block: frame i of a channel is at slot i + i / storageBlockSize. The
+           frames of the current block wait in staging until it is complete. */
+        int storage;
+        std::unique_ptr<unsigned char[]> packed;
+        // Bytes between two channels in packed, and blocks per channel in scales.
+        long packedStride;
+        long scaleStride;
+        std::vector<float> scales;
+        std::vector<float> staging;
+        int stagedFrames;
+
+        GrainSource *source;
+        // Source frames per output sample.
+        double sourceRatio;
+        long sourceLength;
+
+        // Where renderGrains() reads: the recording or the source data.
+        const float *readData;
+        long readOffsets[maxChannels];
+        const unsigned char *readPacked[maxChannels];
+        const float *readScales[maxChannels];
+
+        // Task renderer: each task writes maxChannels * maxBlockSize samples.
+        enum { grainsPerTask = 64 };
+        struct RenderWorkers;
+        int renderBlockSize;
+        std::vector<float> taskOutputs;
+        std::unique_ptr<RenderWorkers> workers;
+        bool renderThreadsEnabled;
 };
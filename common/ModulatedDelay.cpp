@@ -0,0 +1,89 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#include <cmath>
+#include "ModulatedDelay.h"
+
+#ifndef M_PI
+#define M_PI (3.14159265358979323846264338327950288)
+#endif
+
+ModulatedDelay::ModulatedDelay() {
+    m_sampleRate = 44100.0;
+    reset();
+}
+
+ModulatedDelay::~ModulatedDelay() {}
+
+void ModulatedDelay::setup(double sampleRate) {
+    m_sampleRate = sampleRate;
+    reset();
+}
+
+void ModulatedDelay::reset(float phase) {
+    m_phase = phase;
+    for (int i = 0; i <= maxBlockSize; i++) {
+        m_lfo[i] = 0.f;
+    }
+    for (int i = 0; i < maxBlockSize; i++) {
+        m_delays[i] = m_leftGains[i] = m_rightGains[i] = 0.f;
+    }
+}
+
+void ModulatedDelay::renderLfo(const float *frequencies, int numSamples, int shape) {
+    float oneOverSr = static_cast<float> (1.0 / m_sampleRate);
+
+    if (shape == triangle) {
+        // Cheap enough to be computed at every sample.
+        for (int i = 0; i < numSamples; i++) {
+            m_lfo[i] = (m_phase < 0.5f ? m_phase : 1.f - m_phase) * 2.f;
+            m_phase += frequencies[i] * oneOverSr;
+            if (m_phase >= 1.f) {
+                m_phase -= 1.f;
+            }
+        }
+        m_lfo[numSamples] = (m_phase < 0.5f ? m_phase : 1.f - m_phase) * 2.f;
+        return;
+    }
+
+    // Sine at the control points, with the phase of every sample kept exact.
+    float first = sinf(m_phase * static_cast<float> (2.0 * M_PI));
+    for (int start = 0; start < numSamples; start += controlInterval) {
+        int end = start + controlInterval < numSamples ? start + controlInterval : numSamples;
+        for (int i = start; i < end; i++) {
+            m_phase += frequencies[i] * oneOverSr;
+            if (m_phase >= 1.f) {
+                m_phase -= 1.f;
+            }
+        }
+        float last = sinf(m_phase * static_cast<float> (2.0 * M_PI));
+        float slope = (last - first) / (end - start);
+        for (int i = start; i < end; i++) {
+            m_lfo[i] = first + slope * (i - start);
+        }
+        first = last;
+    }
+    m_lfo[numSamples] = first;
+}
+
+const float *ModulatedDelay::getLfo() {
+    return m_lfo;
+}
+
+void ModulatedDelay::processPan(const float *input, float *left, float *right, int numSamples) {
+    renderCurve(m_leftGains, numSamples, [](float x) { return cosf(x * static_cast<float> (M_PI * 0.5)); });
+    renderCurve(m_rightGains, numSamples, [](float x) { return sinf(x * static_cast<float> (M_PI * 0.5)); });
+    for (int i = 0; i < numSamples; i++) {
+        float sample = input[i];
+        left[i] = sample * m_leftGains[i];
+        right[i] = sample * m_rightGains[i];
+    }
+}
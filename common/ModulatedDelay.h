@@ -0,0 +1,102 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+/* Block-rate modulation of a delay. The LFO runs through a whole block
+   first: its phase advances sample by sample, but the sine and the curves
+   derived from the LFO are only evaluated every controlInterval samples and
+   linearly interpolated in between. The delays of the block are rendered
+   once, then each delay line reads the block with one delay per sample
+   (DelayLine::readBlock()). Filters follow the LFO at the control points
+   and the equal-power pan gains are applied over the buffers. */
+class ModulatedDelay {
+    public:
+        enum {
+            // Longest block given to renderLfo().
+            maxBlockSize = 256,
+            controlInterval = 16
+        };
+
+        enum Shape {
+            // Between -1 and 1, 0 at phase 0.
+            sine = 0,
+            // Between 0 and 1, 0 at phase 0 and 1 at phase 0.5.
+            triangle
+        };
+
+        ModulatedDelay();
+        ~ModulatedDelay();
+        void setup(double sampleRate);
+        void reset(float phase = 0.f);
+
+        // Runs the LFO over numSamples, at one frequency (in Hz) per sample.
+        void renderLfo(const float *frequencies, int numSamples, int shape);
+        /* The values of the last block, plus the one of the next sample at
+           index numSamples. */
+        const float *getLfo();
+
+        // output[i] = function(lfo[i]), function being called at the control points only.
+        template <typename Function>
+        void renderCurve(float *output, int numSamples, Function function) {
+            float first = function(m_lfo[0]);
+            for (int start = 0; start < numSamples; start += controlInterval) {
+                int end = start + controlInterval < numSamples ? start + controlInterval : numSamples;
+                float last = function(m_lfo[end]);
+                float slope = (last - first) / (end - start);
+                for (int i = start; i < end; i++) {
+                    output[i] = first + slope * (i - start);
+                }
+                first = last;
+            }
+        }
+
+        /* delays[i] = function(lfo[i]), in samples, called at every sample
+           and in order, so the function may advance smoothed values. */
+        template <typename Function>
+        void renderDelays(int numSamples, Function function) {
+            for (int i = 0; i < numSamples; i++) {
+                m_delays[i] = function(m_lfo[i]);
+            }
+        }
+
+        // Writes input to the line and reads it back with the rendered delays.
+        template <typename Line>
+        void processDelay(Line &delayLine, const float *input, float *output, int numSamples) {
+            delayLine.writeBlock(input, numSamples);
+            delayLine.readBlock(output, numSamples, m_delays);
+        }
+
+        /* Filters samples in place, the filter frequency (in Hz) being
+           frequency(lfo[i]) set at the control points only. */
+        template <typename Filter, typename Function>
+        void processFilter(Filter &filter, float *samples, int numSamples, Function frequency) {
+            for (int start = 0; start < numSamples; start += controlInterval) {
+                int end = start + controlInterval < numSamples ? start + controlInterval : numSamples;
+                filter.setFreq(frequency(m_lfo[start]));
+                for (int i = start; i < end; i++) {
+                    samples[i] = filter.process(samples[i]);
+                }
+            }
+        }
+
+        /* Equal-power pan of input, the position being the LFO (0 is left,
+           1 is right, triangle shape). left and right may be input. */
+        void processPan(const float *input, float *left, float *right, int numSamples);
+
+    private:
+        double m_sampleRate;
+        float m_phase;
+        float m_lfo[maxBlockSize + 1];
+        float m_delays[maxBlockSize];
+        float m_leftGains[maxBlockSize];
+        float m_rightGains[maxBlockSize];
+};
@@ -0,0 +1,150 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#include <algorithm>
+#include "MultiChannelBiquad.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define MULTIBIQUAD_USE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define MULTIBIQUAD_USE_NEON 1
+#endif
+
+MultiChannelBiquad::MultiChannelBiquad() {
+    numGroups = 1;
+    std::fill(coefficients, coefficients + 5, 0.f);
+    reset();
+}
+
+MultiChannelBiquad::~MultiChannelBiquad() {}
+
+void MultiChannelBiquad::setup(double sampleRate, int numberOfChannels) {
+    numberOfChannels = numberOfChannels < 1 ? 1 : numberOfChannels > maxChannels ? maxChannels : numberOfChannels;
+    numGroups = (numberOfChannels + lanes - 1) / lanes;
+    design.setup(sampleRate);
+    updateCoefficients();
+    reset();
+}
+
+void MultiChannelBiquad::reset() {
+    std::fill(s1, s1 + maxChannels, 0.f);
+    std::fill(s2, s2 + maxChannels, 0.f);
+}
+
+void MultiChannelBiquad::setFreq(float freq) {
+    design.setFreq(freq);
+    updateCoefficients();
+}
+
+void MultiChannelBiquad::setQ(float q) {
+    design.setQ(q);
+    updateCoefficients();
+}
+
+void MultiChannelBiquad::setType(int type) {
+    design.setType(type);
+    updateCoefficients();
+}
+
+void MultiChannelBiquad::setParameters(float freq, float q, int type) {
+    design.setParameters(freq, q, type);
+    updateCoefficients();
+}
+
+void MultiChannelBiquad::updateCoefficients() {
+    design.getCoefficients(coefficients);
+}
+
+void MultiChannelBiquad::processBlock(float * const *channels, int numChannels, int numSamples) {
+    numChannels = std::min(numChannels, numGroups * static_cast<int> (lanes));
+
+    for (int group = 0; group < numGroups; group++) {
+        int first = group * lanes;
+        int count = std::min(static_cast<int> (lanes), numChannels - first);
+        if (count <= 0) {
+            break;
+        }
+
+        for (int start = 0; start < numSamples; start += chunkSize) {
+            int size = std::min(static_cast<int> (chunkSize), numSamples - start);
+
+            // One frame of the group per vector.
+            for (int lane = 0; lane < lanes; lane++) {
+                if (lane < count) {
+                    const float *input = channels[first + lane] + start;
+                    for (int i = 0; i < size; i++) {
+                        frames[i * lanes + lane] = input[i];
+                    }
+                } else {
+                    for (int i = 0; i < size; i++) {
+                        frames[i * lanes + lane] = 0.f;
+                    }
+                }
+            }
+
+#if MULTIBIQUAD_USE_SSE2
+            const __m128 b0 = _mm_set1_ps(coefficients[0]);
+            const __m128 b1 = _mm_set1_ps(coefficients[1]);
+            const __m128 b2 = _mm_set1_ps(coefficients[2]);
+            const __m128 a1 = _mm_set1_ps(coefficients[3]);
+            const __m128 a2 = _mm_set1_ps(coefficients[4]);
+            __m128 z1 = _mm_load_ps(s1 + first);
+            __m128 z2 = _mm_load_ps(s2 + first);
+            for (int i = 0; i < size; i++) {
+                __m128 x = _mm_load_ps(frames + i * lanes);
+                __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+                z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+                z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+                _mm_store_ps(frames + i * lanes, y);
+            }
+            _mm_store_ps(s1 + first, z1);
+            _mm_store_ps(s2 + first, z2);
+#elif MULTIBIQUAD_USE_NEON
+            const float32x4_t b0 = vdupq_n_f32(coefficients[0]);
+            const float32x4_t b1 = vdupq_n_f32(coefficients[1]);
+            const float32x4_t b2 = vdupq_n_f32(coefficients[2]);
+            const float32x4_t a1 = vdupq_n_f32(coefficients[3]);
+            const float32x4_t a2 = vdupq_n_f32(coefficients[4]);
+            float32x4_t z1 = vld1q_f32(s1 + first);
+            float32x4_t z2 = vld1q_f32(s2 + first);
+            for (int i = 0; i < size; i++) {
+                float32x4_t x = vld1q_f32(frames + i * lanes);
+                float32x4_t y = vmlaq_f32(z1, b0, x);
+                z1 = vmlsq_f32(vmlaq_f32(z2, b1, x), a1, y);
+                z2 = vmlsq_f32(vmulq_f32(b2, x), a2, y);
+                vst1q_f32(frames + i * lanes, y);
+            }
+            vst1q_f32(s1 + first, z1);
+            vst1q_f32(s2 + first, z2);
+#else
+            for (int i = 0; i < size; i++) {
+                float *frame = frames + i * lanes;
+                for (int lane = 0; lane < lanes; lane++) {
+                    float x = frame[lane];
+                    float y = coefficients[0] * x + s1[first + lane];
+                    s1[first + lane] = coefficients[1] * x - coefficients[3] * y + s2[first + lane];
+                    s2[first + lane] = coefficients[2] * x - coefficients[4] * y;
+                    frame[lane] = y;
+                }
+            }
+#endif
+
+            for (int lane = 0; lane < count; lane++) {
+                float *output = channels[first + lane] + start;
+                for (int i = 0; i < size; i++) {
+                    output[i] = frames[i * lanes + lane];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+#include "Biquad.h"
+
+/* Biquad filtering several channels with the same coefficients, in the
+   transposed direct form II. The channels are processed in groups of 4, one
+   channel per SIMD lane, so a stereo filter costs the same as a mono one and
+   surround layouts up to maxChannels take one more group per 4 channels.
+   The parameters are those of Biquad, which computes the coefficients. */
+class MultiChannelBiquad {
+    public:
+        enum {
+            maxChannels = 8,
+            lanes = 4,
+            // Samples interleaved at once by processBlock().
+            chunkSize = 64
+        };
+
+        MultiChannelBiquad();
+        ~MultiChannelBiquad();
+        void setup(double sampleRate, int numberOfChannels);
+        void reset();
+        void setFreq(float freq);
+        void setQ(float q);
+        void setType(int type);
+        void setParameters(float freq, float q, int type);
+        /* Filters numSamples of the first numChannels channels in place. The
+           lanes of the missing channels, if any, run on silence. */
+        void processBlock(float * const *channels, int numChannels, int numSamples);
+
+    private:
+        void updateCoefficients();
+
+        Biquad design;
+        int numGroups;
+        // b0, b1, b2, a1, a2
+        float coefficients[5];
+        // TDF-II state, one lane per channel.
+        alignas(16) float s1[maxChannels];
+        alignas(16) float s2[maxChannels];
+        alignas(16) float frames[chunkSize * lanes];
+};
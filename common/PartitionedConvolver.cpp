@@ -0,0 +1,288 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#include "PartitionedConvolver.h"
+
+#ifndef M_PI
+#define M_PI (3.14159265358979323846264338327950288)
+#endif
+
+PartitionedConvolver::PartitionedConvolver() : fadingKernel(nullptr), spareKernel(&kernels[1]), readyKernel(nullptr),
+                                               requestedOrder(10), requestedMinimumPhase(true), requestSerial(0),
+                                               builtSerial(0), partitionFFT(nullptr), prepared(false), numChannels(1), partitionSize(0),
+                                               numBins(0), maxPartitions(0), maxKernelOrder(0),
+                                               blockPosition(0), spectrumIndex(0) {
+    activeKernel = &kernels[0];
+}
+
+PartitionedConvolver::~PartitionedConvolver() {
+    builder->removeTimeSliceClient(this);
+}
+
+void PartitionedConvolver::prepare(int channels, int partitionOrder, int maxOrder) {
+    // Keep the builder thread away while the kernels are rebuilt.
+    builder->removeTimeSliceClient(this);
+
+    numChannels = jlimit(1, (int)maxChannels, channels);
+    partitionSize = 1 << partitionOrder;
+    numBins = partitionSize + 1;
+    maxKernelOrder = jmax(partitionOrder, maxOrder);
+    maxPartitions = (1 << maxKernelOrder) / partitionSize;
+
+    partitionFFT = cache->getPlan(partitionOrder + 1);
+    for (int channel = 0; channel < maxChannels; channel++) {
+        int used = channel < numChannels ? 1 : 0;
+        inputBlocks[channel].allocate(used * 2 * partitionSize, true);
+        outputBlocks[channel].allocate(used * partitionSize, true);
+        spectra[channel].allocate(used * maxPartitions * numBins, true);
+    }
+    accumulator.allocate(numBins, true);
+    fftBuffer.allocate(4 * partitionSize, true);
+    fadeBuffer.allocate(partitionSize, true);
+
+    for (auto& kernel : kernels) {
+        kernel.partitions.allocate(maxPartitions * numBins, true);
+        kernel.numPartitions = 0;
+    }
+
+    activeKernel = &kernels[0];
+    fadingKernel = nullptr;
+    spareKernel.store(&kernels[1]);
+    readyKernel.store(nullptr);
+
+    builtSerial = requestSerial.load();
+    designKernel(activeKernel, requestedOrder.load(), requestedMinimumPhase.load());
+
+    prepared = true;
+    reset();
+
+    builder->addTimeSliceClient(this);
+}
+
+void PartitionedConvolver::reset() {
+    blockPosition = 0;
+    spectrumIndex = 0;
+    if (! prepared)
+        return;
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        FloatVectorOperations::clear(inputBlocks[channel], 2 * partitionSize);
+        FloatVectorOperations::clear(outputBlocks[channel], partitionSize);
+        zeromem(spectra[channel], sizeof(dsp::Complex<float>) * maxPartitions * numBins);
+    }
+}
+
+void PartitionedConvolver::setResponse(const float *magnitudes, int numberOfBins) {
+    Array<float> newResponse (magnitudes, numberOfBins);
+    {
+        const SpinLock::ScopedLockType lock (responseLock);
+        response.swapWith(newResponse);
+    }
+    requestSerial++;
+}
+
+void PartitionedConvolver::setKernelOrder(int order) {
+    if (requestedOrder.exchange(order) != order)
+        requestSerial++;
+}
+
+void PartitionedConvolver::setMinimumPhase(bool shouldBeMinimumPhase) {
+    if (requestedMinimumPhase.exchange(shouldBeMinimumPhase) != shouldBeMinimumPhase)
+        requestSerial++;
+}
+
+int PartitionedConvolver::getLatencyInSamples() {
+    int order = jlimit(0, maxKernelOrder, requestedOrder.load());
+    return requestedMinimumPhase.load() ? partitionSize : partitionSize + (1 << order) / 2;
+}
+
+int PartitionedConvolver::useTimeSlice() {
+    int serial = requestSerial.load();
+    if (serial == builtSerial)
+        return 10;
+
+    Kernel *newKernel = spareKernel.exchange(nullptr);
+    if (newKernel == nullptr)
+        return 10;  // The previous kernel has not been picked up yet.
+
+    designKernel(newKernel, requestedOrder.load(), requestedMinimumPhase.load());
+    builtSerial = serial;
+
+    readyKernel.store(newKernel);
+    return 10;
+}
+
+void PartitionedConvolver::designKernel(Kernel *kernel, int order, bool minimumPhase) {
+    // Never called on the audio thread, allocations are fine here.
+    Array<float> magnitudes;
+    {
+        const SpinLock::ScopedLockType lock (responseLock);
+        magnitudes = response;
+    }
+
+    order = jlimit(0, maxKernelOrder, order);
+    int kernelSize = 1 << order;
+
+    // The response is designed on a denser grid, which keeps the aliasing of
+    // the minimum phase cepstrum and the truncation of the linear phase
+    // impulse away from the kernel.
+    int designOrder = order + 2;
+    int designSize = 1 << designOrder;
+    int half = designSize / 2;
+    const dsp::FFT *designFFT = cache->getPlan(designOrder);
+    HeapBlock<float> spectrum (2 * designSize, true);
+    HeapBlock<float> impulse (kernelSize, true);
+
+    for (int k = 0; k <= half; k++) {
+        float magnitude = 0.0f;
+        if (magnitudes.size() > 1) {
+            float index = k / (float)half * (magnitudes.size() - 1);
+            int ipart = jmin((int)index, magnitudes.size() - 2);
+            float fpart = index - ipart;
+            magnitude = magnitudes[ipart] + (magnitudes[ipart+1] - magnitudes[ipart]) * fpart;
+        }
+        spectrum[k*2] = minimumPhase ? std::log (jmax(magnitude, 1.0e-5f)) : magnitude;
+        spectrum[k*2+1] = 0.0f;
+    }
+    designFFT->performRealOnlyInverseTransform (spectrum);
+
+    if (minimumPhase) {
+        // Folds the real cepstrum onto positive quefrencies, then back to a
+        // minimum phase spectrum with the complex exponential.
+        for (int n = 1; n < half; n++) {
+            spectrum[n] *= 2.0f;
+        }
+        FloatVectorOperations::clear(spectrum + half + 1, 2 * designSize - half - 1);
+        designFFT->performRealOnlyForwardTransform (spectrum, true);
+        for (int k = 0; k <= half; k++) {
+            dsp::Complex<float> value = std::exp (dsp::Complex<float> (spectrum[k*2], spectrum[k*2+1]));
+            spectrum[k*2] = value.real();
+            spectrum[k*2+1] = value.imag();
+        }
+        designFFT->performRealOnlyInverseTransform (spectrum);
+
+        // Half Hann fade over the last quarter of the kernel.
+        int fadeStart = kernelSize * 3 / 4;
+        for (int i = 0; i < kernelSize; i++) {
+            float fade = i < fadeStart ? 1.0f : 0.5f + 0.5f * cosf(M_PI * (i - fadeStart) / (kernelSize - fadeStart));
+            impulse[i] = spectrum[i] * fade;
+        }
+    } else {
+        // Zero phase impulse centered in the kernel, with a Blackman window.
+        for (int i = 0; i < kernelSize; i++) {
+            int n = (i - kernelSize / 2 + designSize) & (designSize - 1);
+            float window = 0.42f - 0.5f * cosf(2.0f * M_PI * i / kernelSize) + 0.08f * cosf(4.0f * M_PI * i / kernelSize);
+            impulse[i] = spectrum[n] * window;
+        }
+    }
+
+    // Spectra of the zero-padded partitions.
+    HeapBlock<float> buffer (4 * partitionSize, true);
+    kernel->numPartitions = jmax(1, kernelSize / partitionSize);
+    for (int p = 0; p < kernel->numPartitions; p++) {
+        FloatVectorOperations::clear(buffer, 4 * partitionSize);
+        FloatVectorOperations::copy(buffer, impulse + p * partitionSize, jmin(partitionSize, kernelSize));
+        partitionFFT->performRealOnlyForwardTransform (buffer, true);
+        dsp::Complex<float> *partition = kernel->partitions + p * numBins;
+        for (int k = 0; k < numBins; k++) {
+            partition[k] = dsp::Complex<float> (buffer[k*2], buffer[k*2+1]);
+        }
+    }
+}
+
+void PartitionedConvolver::convolve(const Kernel *kernel, int channel, float *output) {
+    zeromem(accumulator, sizeof(dsp::Complex<float>) * numBins);
+    for (int p = 0; p < kernel->numPartitions; p++) {
+        int slot = spectrumIndex - p;
+        slot = slot < 0 ? slot + maxPartitions : slot;
+        const dsp::Complex<float> *input = spectra[channel] + slot * numBins;
+        const dsp::Complex<float> *partition = kernel->partitions + p * numBins;
+        for (int k = 0; k < numBins; k++) {
+            accumulator[k] += input[k] * partition[k];
+        }
+    }
+
+    for (int k = 0; k < numBins; k++) {
+        fftBuffer[k*2] = accumulator[k].real();
+        fftBuffer[k*2+1] = accumulator[k].imag();
+    }
+    partitionFFT->performRealOnlyInverseTransform (fftBuffer);
+
+    // Overlap-save: only the second half is a valid linear convolution.
+    FloatVectorOperations::copy(output, fftBuffer + partitionSize, partitionSize);
+}
+
+void PartitionedConvolver::computePartition() {
+    Kernel *newKernel = readyKernel.exchange(nullptr);
+    if (newKernel != nullptr) {
+        fadingKernel = activeKernel;
+        activeKernel = newKernel;
+    }
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        FloatVectorOperations::clear(fftBuffer, 4 * partitionSize);
+        FloatVectorOperations::copy(fftBuffer, inputBlocks[channel], 2 * partitionSize);
+        partitionFFT->performRealOnlyForwardTransform (fftBuffer, true);
+        dsp::Complex<float> *input = spectra[channel] + spectrumIndex * numBins;
+        for (int k = 0; k < numBins; k++) {
+            input[k] = dsp::Complex<float> (fftBuffer[k*2], fftBuffer[k*2+1]);
+        }
+
+        // Slides the input by one partition.
+        FloatVectorOperations::copy(inputBlocks[channel], inputBlocks[channel] + partitionSize, partitionSize);
+
+        convolve(activeKernel, channel, outputBlocks[channel]);
+
+        if (fadingKernel != nullptr) {
+            convolve(fadingKernel, channel, fadeBuffer);
+            for (int i = 0; i < partitionSize; i++) {
+                float gain = (float)i / partitionSize;
+                outputBlocks[channel][i] = outputBlocks[channel][i] * gain + fadeBuffer[i] * (1.0f - gain);
+            }
+        }
+    }
+
+    if (fadingKernel != nullptr) {
+        spareKernel.store(fadingKernel);
+        fadingKernel = nullptr;
+    }
+
+    spectrumIndex++;
+    if (spectrumIndex == maxPartitions)
+        spectrumIndex = 0;
+}
+
+void PartitionedConvolver::processBlock(float **channelData, int channels, int numSamples) {
+    if (! prepared) {
+        for (int channel = 0; channel < channels; channel++) {
+            FloatVectorOperations::clear(channelData[channel], numSamples);
+        }
+        return;
+    }
+
+    channels = jmin(channels, numChannels);
+    int done = 0;
+    while (done < numSamples) {
+        int span = jmin(partitionSize - blockPosition, numSamples - done);
+        for (int channel = 0; channel < channels; channel++) {
+            float *data = channelData[channel] + done;
+            FloatVectorOperations::copy(inputBlocks[channel] + partitionSize + blockPosition, data, span);
+            FloatVectorOperations::copy(data, outputBlocks[channel] + blockPosition, span);
+        }
+
+        done += span;
+        blockPosition += span;
+        if (blockPosition == partitionSize) {
+            computePartition();
+            blockPosition = 0;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FFTEngine.h"
+
+/** Uniformly partitioned overlap-save convolver.
+
+    The kernel is designed from a magnitude response, as a linear or a
+    minimum phase FIR, on the background builder thread shared with the
+    FFT engines. A new kernel is picked up at the next partition boundary
+    and crossfaded with the previous one over a single partition. */
+class PartitionedConvolver : private TimeSliceClient
+{
+public:
+    PartitionedConvolver();
+    ~PartitionedConvolver();
+
+    /** Allocates everything, must be called from prepareToPlay. The latency
+        is one partition (1 << partitionOrder samples) for a minimum phase
+        kernel, plus half the kernel size for a linear phase one. */
+    void prepare(int numChannels, int partitionOrder, int maxKernelOrder);
+    void reset();
+
+    /** Magnitude response sampled on numBins linear bins, from 0 Hz to
+        Nyquist. Copies the data, must not be called from the audio thread. */
+    void setResponse(const float *magnitudes, int numBins);
+
+    void setKernelOrder(int order);
+    void setMinimumPhase(bool shouldBeMinimumPhase);
+
+    /** Processes the channels in place. */
+    void processBlock(float **channelData, int numChannels, int numSamples);
+
+    int getLatencyInSamples();
+
+private:
+    enum
+    {
+        maxChannels = 2
+    };
+
+    // Spectra of the kernel partitions, numBins complex values each.
+    struct Kernel
+    {
+        HeapBlock<dsp::Complex<float>> partitions;
+        int numPartitions = 0;
+    };
+
+    int useTimeSlice() override;
+    void designKernel(Kernel *kernel, int order, bool minimumPhase);
+    void computePartition();
+    void convolve(const Kernel *kernel, int channel, float *output);
+
+    SharedResourcePointer<FFTEngineBuilder> builder;
+    SharedResourcePointer<FFTCache> cache;
+
+    // Same hand-over as the FFTEngine setups: the builder thread takes the
+    // spare kernel and returns it filled through readyKernel.
+    Kernel kernels[2];
+    Kernel *activeKernel;
+    Kernel *fadingKernel;
+    std::atomic<Kernel*> spareKernel;
+    std::atomic<Kernel*> readyKernel;
+
+    SpinLock responseLock;
+    Array<float> response;
+
+    std::atomic<int> requestedOrder;
+    std::atomic<bool> requestedMinimumPhase;
+    std::atomic<int> requestSerial;
+    int builtSerial;
+
+    const dsp::FFT *partitionFFT;
+
+    // Last two partitions of input, transformed as a whole (overlap-save).
+    HeapBlock<float> inputBlocks[maxChannels];
+    HeapBlock<float> outputBlocks[maxChannels];
+    // Frequency-domain delay line, maxPartitions input spectra per channel.
+    HeapBlock<dsp::Complex<float>> spectra[maxChannels];
+    HeapBlock<dsp::Complex<float>> accumulator;
+    HeapBlock<float> fftBuffer;
+    HeapBlock<float> fadeBuffer;
+
+    bool prepared;
+    int numChannels;
+    int partitionSize;
+    int numBins;
+    int maxPartitions;
+    int maxKernelOrder;
+    int blockPosition;
+    int spectrumIndex;
+};
@@ -0,0 +1,69 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#include "SpectralCurve.h"
+
+#ifndef M_PI
+#define M_PI (3.14159265358979323846264338327950288)
+#endif
+
+SpectralCurve::SpectralCurve() : latest(1), backIndex(0), frontIndex(2), currentNumBins(0), smoothing(0.0f) {
+    for (auto& table : tables) {
+        table.allocate(tableSize, true);
+    }
+    target.allocate(tableSize, true);
+    current.allocate(tableSize, true);
+}
+
+void SpectralCurve::computeTable(const Array<float> &points, float *table, int numBins) {
+    int numPoints = points.size();
+    for (int i = 0; i < numBins; i++) {
+        float index = sinf(i / (float)numBins * M_PI / 2.0f) * numPoints;
+        int ipart = (int)index;
+        float fpart = index - ipart;
+        table[i] = points[ipart] + (points[ipart+1] - points[ipart]) * fpart;
+    }
+}
+
+void SpectralCurve::setPoints(const Array<float> &points) {
+    computeTable(points, tables[backIndex], tableSize);
+    backIndex = latest.exchange(backIndex | newTableFlag) & indexMask;
+}
+
+const float * SpectralCurve::getCurve(int numBins) {
+    bool changed = numBins != currentNumBins;
+    if (latest.load() & newTableFlag) {
+        frontIndex = latest.exchange(frontIndex) & indexMask;
+        changed = true;
+    }
+
+    if (changed) {
+        // Power of two FFT sizes, so the bins fall exactly on the table.
+        int step = (tableSize - 1) / jmax(1, numBins - 1);
+        const float *table = tables[frontIndex];
+        for (int i = 0; i < numBins; i++) {
+            target[i] = table[i * step];
+        }
+    }
+
+    float amount = smoothing.load();
+    if (amount == 0.0f || numBins != currentNumBins) {
+        if (changed)
+            FloatVectorOperations::copy(current, target, numBins);
+    } else {
+        for (int i = 0; i < numBins; i++) {
+            current[i] += (target[i] - current[i]) * amount;
+        }
+    }
+
+    currentNumBins = numBins;
+    return current;
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/** A per-bin curve (gain, delay, feedback...) drawn in the editor and read
+    by a spectral process on the audio thread.
+
+    The message thread computes the whole table at the finest resolution
+    (8193 bins, an FFT of 16384 points) and publishes it through a triple
+    buffer, with a single atomic exchange. The audio thread picks up the
+    latest table at the start of a frame and decimates it to the current
+    FFT size, only when the table or the size changed. Neither side ever
+    waits on the other and no curve math runs on the audio thread. */
+class SpectralCurve
+{
+public:
+    enum
+    {
+        tableOrder = 13,
+        tableSize = (1 << tableOrder) + 1
+    };
+
+    SpectralCurve();
+
+    /** Message thread only. Warps the points on the bins (more points for
+        the low frequencies) and publishes the new table. */
+    void setPoints(const Array<float> &points);
+
+    /** Audio thread only. Returns the curve for numBins bins (fftSize / 2 + 1),
+        valid until the next call. */
+    const float * getCurve(int numBins);
+
+    /** When above 0, the curve returned by getCurve() moves toward a new
+        table by this fraction at each call instead of jumping to it. */
+    void setSmoothing(float amount) { smoothing = jlimit(0.0f, 1.0f, amount); }
+
+    /** The warping used by setPoints(), on any number of bins. */
+    static void computeTable(const Array<float> &points, float *table, int numBins);
+
+private:
+    enum
+    {
+        newTableFlag = 4,
+        indexMask = 3
+    };
+
+    HeapBlock<float> tables[3];
+    // Index of the last published table, plus newTableFlag until it is read.
+    std::atomic<int> latest;
+    int backIndex;
+    int frontIndex;
+
+    HeapBlock<float> target;
+    HeapBlock<float> current;
+    int currentNumBins;
+    std::atomic<float> smoothing;
+};
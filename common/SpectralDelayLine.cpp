@@ -0,0 +1,74 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#include "SpectralDelayLine.h"
+
+SpectralDelayLine::SpectralDelayLine() : generation(1), capacity(0), maxFrames(0), numBins(0), numFrames(1), writeIndex(0) {}
+
+void SpectralDelayLine::prepare(int maxNumBins, int maxNumFrames) {
+    capacity = maxNumBins * maxNumFrames;
+    maxFrames = maxNumFrames;
+    realStore.allocate(capacity, true);
+    imagStore.allocate(capacity, true);
+    frameStamps.allocate(maxFrames, true);
+    generation = 1;
+    numBins = 0;
+    numFrames = 1;
+    writeIndex = 0;
+}
+
+void SpectralDelayLine::setup(int bins, int frames) {
+    jassert (bins * frames <= capacity);
+    numFrames = jlimit(1, jmax(1, maxFrames), frames);
+    numBins = capacity > 0 ? jmin(bins, capacity / numFrames) : 0;
+    reset();
+}
+
+void SpectralDelayLine::reset() {
+    writeIndex = 0;
+    if (++generation == 0) {
+        // After 2^32 resets, the old stamps could match again.
+        if (maxFrames > 0)
+            zeromem(frameStamps, sizeof(unsigned int) * (size_t) maxFrames);
+        generation = 1;
+    }
+}
+
+void SpectralDelayLine::process(float *real, float *imag, const float *delays, const float *feedbacks) {
+    if (numBins == 0)
+        return;
+
+    float *writeReal = realStore + writeIndex * numBins;
+    float *writeImag = imagStore + writeIndex * numBins;
+
+    for (int k = 0; k < numBins; k++) {
+        // A delay of 0 reads the slot about to be overwritten, the oldest one.
+        int readIndex = writeIndex - (int)(delays[k] * numFrames);
+        if (readIndex < 0) {
+            readIndex += numFrames;
+        }
+
+        float realTemp = 0.0f, imagTemp = 0.0f;
+        if (readIndex >= 0 && readIndex < numFrames && frameStamps[readIndex] == generation) {
+            realTemp = realStore[readIndex * numBins + k];
+            imagTemp = imagStore[readIndex * numBins + k];
+        }
+        writeReal[k] = real[k] + realTemp * feedbacks[k];
+        writeImag[k] = imag[k] + imagTemp * feedbacks[k];
+        real[k] = realTemp;
+        imag[k] = imagTemp;
+    }
+    frameStamps[writeIndex] = generation;
+
+    writeIndex++;
+    if (writeIndex >= numFrames)
+        writeIndex = 0;
+}
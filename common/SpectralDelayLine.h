@@ -0,0 +1,56 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/** Per-bin delay line for split-complex spectra. The history is a ring of
+    numFrames frames, each one a contiguous row of numBins real and numBins
+    imaginary values, so every frame is written in one sweep. */
+class SpectralDelayLine
+{
+public:
+    SpectralDelayLine();
+
+    /** Allocates room for numBins * numFrames complex values. Must not be
+        called from the audio thread. */
+    void prepare(int maxNumBins, int maxNumFrames);
+
+    /** Changes the frame size and the length of the delay line, without
+        allocating, and clears the history. numBins * numFrames must fit
+        in what was prepared. */
+    void setup(int numBins, int numFrames);
+
+    /** Clears the history in constant time: the frames written before are
+        read as silence until they are written again. */
+    void reset();
+
+    /** Replaces each bin with its value delays[k] * numFrames frames ago
+        (delays between 0 and 1), and writes the input plus the delayed value
+        scaled by feedbacks[k] back into the line. */
+    void process(float *real, float *imag, const float *delays, const float *feedbacks);
+
+    int getNumFrames() { return numFrames; }
+
+private:
+    HeapBlock<float> realStore;
+    HeapBlock<float> imagStore;
+    // Generation in which each frame was written, older ones are silent.
+    HeapBlock<unsigned int> frameStamps;
+    unsigned int generation;
+
+    int capacity;
+    int maxFrames;
+    int numBins;
+    int numFrames;
+    int writeIndex;
+};
@@ -0,0 +1,82 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#include "SpectralOps.h"
+
+#ifndef M_PI
+#define M_PI (3.14159265358979323846264338327950288)
+#endif
+
+void SpectralOps::multiply(float *real, float *imag, const float *gains, int numBins) noexcept {
+    FloatVectorOperations::multiply(real, gains, numBins);
+    FloatVectorOperations::multiply(imag, gains, numBins);
+}
+
+void SpectralOps::complexMultiply(float *real, float *imag,
+                                  const float *otherReal, const float *otherImag, int numBins) noexcept {
+    for (int k = 0; k < numBins; k++) {
+        float re = real[k], im = imag[k];
+        real[k] = re * otherReal[k] - im * otherImag[k];
+        imag[k] = re * otherImag[k] + im * otherReal[k];
+    }
+}
+
+void SpectralOps::complexMultiplyAdd(float *accumReal, float *accumImag,
+                                     const float *real, const float *imag,
+                                     const float *otherReal, const float *otherImag, int numBins) noexcept {
+    for (int k = 0; k < numBins; k++) {
+        accumReal[k] += real[k] * otherReal[k] - imag[k] * otherImag[k];
+        accumImag[k] += real[k] * otherImag[k] + imag[k] * otherReal[k];
+    }
+}
+
+void SpectralOps::magnitude(const float *real, const float *imag, float *magnitudes, int numBins) noexcept {
+    for (int k = 0; k < numBins; k++) {
+        magnitudes[k] = std::sqrt(real[k] * real[k] + imag[k] * imag[k]);
+    }
+}
+
+// Polynomial atan2, max error below 1e-5 rad, without the branches of
+// std::atan2 that keep the loop from being vectorized.
+static inline float fastAtan2(float y, float x) noexcept {
+    float ax = std::abs(x), ay = std::abs(y);
+    float mx = ax > ay ? ax : ay;
+    float mn = ax > ay ? ay : ax;
+    float a = mn / (mx + 1.0e-30f);
+    float s = a * a;
+    float r = ((((-0.0117212f * s + 0.05265332f) * s - 0.11643287f) * s + 0.19354346f) * s - 0.33262347f) * s + 0.99997726f;
+    r *= a;
+    r = ay > ax ? (float)M_PI / 2.0f - r : r;
+    r = x < 0.0f ? (float)M_PI - r : r;
+    return y < 0.0f ? -r : r;
+}
+
+void SpectralOps::phase(const float *real, const float *imag, float *phases, int numBins) noexcept {
+    for (int k = 0; k < numBins; k++) {
+        phases[k] = fastAtan2(imag[k], real[k]);
+    }
+}
+
+void SpectralOps::toPolar(float *real, float *imag, int numBins) noexcept {
+    for (int k = 0; k < numBins; k++) {
+        float re = real[k], im = imag[k];
+        real[k] = std::sqrt(re * re + im * im);
+        imag[k] = fastAtan2(im, re);
+    }
+}
+
+void SpectralOps::toCartesian(float *magnitude, float *phase, int numBins) noexcept {
+    for (int k = 0; k < numBins; k++) {
+        float mag = magnitude[k], ph = phase[k];
+        magnitude[k] = mag * std::cos(ph);
+        phase[k] = mag * std::sin(ph);
+    }
+}
@@ -0,0 +1,44 @@
+/*******************************************************************************
+* Plugex - PLUGin EXamples
+*
+* Plugex est une série de plugiciels auto-documentés permettant une étude 
+* autonome du développement de plugiciels avec JUCE ainsi que des bases du
+* traitement de signal audio avec le langage C++.
+*
+* © Olivier Bélanger 2019
+*
+*******************************************************************************/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/** Bin kernels on split-complex spectra, as delivered by FFTEngine in split
+    mode. Every array holds numBins contiguous values and the loops are
+    written so that the compiler can vectorize them. Output arrays may alias
+    the input arrays they replace (real -> real, imag -> imag). */
+class SpectralOps
+{
+public:
+    /** real and imag *= gains. */
+    static void multiply(float *real, float *imag, const float *gains, int numBins) noexcept;
+
+    /** (real + i imag) *= (otherReal + i otherImag). */
+    static void complexMultiply(float *real, float *imag,
+                                const float *otherReal, const float *otherImag, int numBins) noexcept;
+
+    /** Same as complexMultiply, then adds the product to the accumulators. */
+    static void complexMultiplyAdd(float *accumReal, float *accumImag,
+                                   const float *real, const float *imag,
+                                   const float *otherReal, const float *otherImag, int numBins) noexcept;
+
+    static void magnitude(const float *real, const float *imag, float *magnitudes, int numBins) noexcept;
+
+    static void phase(const float *real, const float *imag, float *phases, int numBins) noexcept;
+
+    /** Converts in place, real becomes the magnitude and imag the phase. */
+    static void toPolar(float *real, float *imag, int numBins) noexcept;
+
+    /** Converts in place, magnitude becomes the real part and phase the imaginary part. */
+    static void toCartesian(float *magnitude, float *phase, int numBins) noexcept;
+};
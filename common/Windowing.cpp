@@ -21,12 +21,13 @@ Windowing::Windowing() {}
 Windowing::~Windowing() {}
 
 void Windowing::setup(int size, WindowType type) {
+    windowTable = cache->getWindow(size, type);
+}
+
+void Windowing::fillWindowingTable (float *window, int size, WindowType type) noexcept {
     int i;
     float arg;
 
-    windowTable.resize(size);
-    float *window = windowTable.getRawDataPointer();
-
     switch (type) {
         case rectangular:
             for (i = 0; i < size; i++) {
@@ -102,7 +103,13 @@ void Windowing::setup(int size, WindowType type) {
 }
 
 void Windowing::multiplyWithWindowingTable (float *samples, int size) noexcept {
-    FloatVectorOperations::multiply (samples, windowTable.getRawDataPointer(), jmin (size, windowTable.size()));
+    if (windowTable == nullptr)
+        return;
+    FloatVectorOperations::multiply (samples, windowTable->data, jmin (size, windowTable->size));
+}
+
+const float* Windowing::getWindowingTable() const noexcept {
+    return windowTable == nullptr ? nullptr : windowTable->data.getData();
 }
 
 const char* Windowing::getWindowingMethodName (WindowType type) noexcept {
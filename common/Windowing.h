@@ -12,6 +12,7 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "FFTCache.h"
 
 class Windowing 
 {
@@ -34,16 +35,25 @@ public:
     Windowing();
     ~Windowing();
 
+    /** Borrows the table from the process-wide FFTCache, building it on first
+        use. Locks, must not be called from the audio thread. */
     void setup(int size, WindowType type);
 
     /** Multiplies the content of a buffer with the given window. */
     void multiplyWithWindowingTable (float *samples, int size) noexcept;
 
+    /** Returns the table borrowed by setup, or nullptr before the first setup. */
+    const float* getWindowingTable() const noexcept;
+
     /** Returns the name of a given windowing method. */
     static const char* getWindowingMethodName (WindowType type) noexcept;
 
+    /** Computes a window of the given size and type. */
+    static void fillWindowingTable (float *window, int size, WindowType type) noexcept;
+
 private:
-    Array<float> windowTable;
+    SharedResourcePointer<FFTCache> cache;
+    FFTCache::WindowTable::Ptr windowTable;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Windowing)
 };
\ No newline at end of file